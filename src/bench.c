@@ -0,0 +1,133 @@
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+#include "timer.h"
+
+static const char* metric_names[BENCH_METRICS] = { "frame_ms", "transform_ms", "upload_ms", "gpu_ms" };
+
+int bench_init(Bench* bench, int frames) {
+    memset(bench, 0, sizeof(*bench));
+    bench->frames = frames;
+    bench->total = BENCH_WARMUP + frames;
+    for (int m = 0; m < BENCH_METRICS; m++) {
+        bench->samples[m] = calloc(frames, sizeof(float));
+        if (!bench->samples[m]) {
+            bench_destroy(bench);
+            return 0;
+        }
+    }
+    glGenQueries(BENCH_QUERIES, bench->queries);
+    return 1;
+}
+
+void bench_destroy(Bench* bench) {
+    for (int m = 0; m < BENCH_METRICS; m++) free(bench->samples[m]);
+    if (bench->queries[0]) glDeleteQueries(BENCH_QUERIES, bench->queries);
+    memset(bench, 0, sizeof(*bench));
+}
+
+// Slot of the current frame, NULL while warming up
+static float* sample(Bench* bench, BenchMetric metric, int frame) {
+    if (frame < BENCH_WARMUP) return NULL;
+    return &bench->samples[metric][frame - BENCH_WARMUP];
+}
+
+// Blocks until the frame's query has a result, only called once it's a few frames old
+static void read_query(Bench* bench, int frame) {
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(bench->queries[frame % BENCH_QUERIES], GL_QUERY_RESULT, &elapsed);
+    float* slot = sample(bench, BENCH_GPU, frame);
+    if (slot) *slot = (float)(elapsed / 1e6);
+}
+
+void bench_begin_frame(Bench* bench) {
+    bench->frame_start = timer_now();
+    glBeginQuery(GL_TIME_ELAPSED, bench->queries[bench->frame % BENCH_QUERIES]);
+}
+
+void bench_end_gpu(Bench* bench) {
+    (void)bench;
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+void bench_end_frame(Bench* bench) {
+    float* slot = sample(bench, BENCH_FRAME, bench->frame);
+    if (slot) *slot = (float)((timer_now() - bench->frame_start) * 1000.0);
+    // Free the slot the next frame reuses
+    int oldest = bench->frame - (BENCH_QUERIES - 1);
+    if (oldest >= 0) read_query(bench, oldest);
+    bench->frame++;
+}
+
+void bench_add(Bench* bench, BenchMetric metric, double seconds) {
+    float* slot = sample(bench, metric, bench->frame);
+    if (slot) *slot += (float)(seconds * 1000.0);
+}
+
+void bench_finish(Bench* bench) {
+    int first = bench->frame - (BENCH_QUERIES - 1);
+    for (int frame = first > 0 ? first : 0; frame < bench->frame; frame++) {
+        read_query(bench, frame);
+    }
+}
+
+static int compare_float(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank on sorted samples
+static float percentile(const float* sorted, int count, int p) {
+    int rank = (p * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+float bench_percentile(const Bench* bench, BenchMetric metric, int p) {
+    int count = bench->frame - BENCH_WARMUP;
+    if (count > bench->frames) count = bench->frames;
+    float* sorted = malloc(sizeof(float) * (count > 0 ? count : 1));
+    if (!sorted || count <= 0) {
+        free(sorted);
+        return 0.0f;
+    }
+    memcpy(sorted, bench->samples[metric], sizeof(float) * count);
+    qsort(sorted, count, sizeof(float), compare_float);
+    float value = percentile(sorted, count, p);
+    free(sorted);
+    return value;
+}
+
+// One "key": "value" line, quotes, backslashes and control characters escaped (NULL writes an empty string)
+static void write_string(FILE* out, const char* key, const char* value) {
+    fprintf(out, "  \"%s\": \"", key);
+    for (const unsigned char* c = (const unsigned char*)(value ? value : ""); *c; c++) {
+        if (*c == '"' || *c == '\\') fprintf(out, "\\%c", *c);
+        else if (*c < 0x20) fprintf(out, "\\u%04x", *c);
+        else fputc(*c, out);
+    }
+    fprintf(out, "\",\n");
+}
+
+void bench_report(const Bench* bench, FILE* out, const char* shape, int v_count, int e_count, const char* path) {
+    int count = bench->frame - BENCH_WARMUP;
+    if (count > bench->frames) count = bench->frames;
+    float* sorted = malloc(sizeof(float) * (count > 0 ? count : 1));
+
+    fprintf(out, "{\n");
+    write_string(out, "shape", shape);
+    fprintf(out, "  \"vertices\": %d,\n  \"edges\": %d,\n", v_count, e_count);
+    write_string(out, "path", path);
+    write_string(out, "renderer", (const char*)glGetString(GL_RENDERER));
+    fprintf(out, "  \"warmup\": %d,\n  \"frames\": %d", BENCH_WARMUP, count);
+    for (int m = 0; m < BENCH_METRICS && sorted && count > 0; m++) {
+        memcpy(sorted, bench->samples[m], sizeof(float) * count);
+        qsort(sorted, count, sizeof(float), compare_float);
+        double sum = 0.0;
+        for (int i = 0; i < count; i++) sum += sorted[i];
+        fprintf(out, ",\n  \"%s\": { \"min\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+                metric_names[m], sorted[0], sum / count, percentile(sorted, count, 50), percentile(sorted, count, 95),
+                percentile(sorted, count, 99), sorted[count - 1]);
+    }
+    fprintf(out, "\n}\n");
+    free(sorted);
+}
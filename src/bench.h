@@ -0,0 +1,50 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <glad/glad.h>
+
+// Frame Benchmark
+// Per-frame timings of a --bench run: the whole frame, the CPU transform, handing data to GL and the GPU time
+// from GL_TIME_ELAPSED queries. Queries are read BENCH_QUERIES-1 frames after they end, so waiting on them
+// doesn't stall the pipeline. The first BENCH_WARMUP frames (first uploads, shader compiles) aren't recorded.
+
+#define BENCH_QUERIES 4
+#define BENCH_WARMUP 30
+
+typedef enum {
+    BENCH_FRAME,
+    BENCH_TRANSFORM,
+    BENCH_UPLOAD,
+    BENCH_GPU,
+    BENCH_METRICS
+} BenchMetric;
+
+typedef struct {
+    int frames;						// Recorded frames
+    int total;						// Including warmup
+    int frame;						// Frames finished so far
+    float* samples[BENCH_METRICS];	// Milliseconds, frames each
+    GLuint queries[BENCH_QUERIES];
+    double frame_start;
+} Bench;
+
+// 0 if out of memory
+int bench_init(Bench* bench, int frames);
+void bench_destroy(Bench* bench);
+
+// Bracket everything a frame draws; end the GPU part before the swap and the frame after it
+void bench_begin_frame(Bench* bench);
+void bench_end_gpu(Bench* bench);
+void bench_end_frame(Bench* bench);
+// Add seconds spent in transform or upload to the current frame
+void bench_add(Bench* bench, BenchMetric metric, double seconds);
+// Collect the queries still in flight
+void bench_finish(Bench* bench);
+
+// pth percentile of a metric over the recorded frames, 0 if there are none
+float bench_percentile(const Bench* bench, BenchMetric metric, int p);
+// min, mean, p50, p95, p99 and max of every metric as one JSON object
+void bench_report(const Bench* bench, FILE* out, const char* shape, int v_count, int e_count, const char* path);
+
+#endif
@@ -0,0 +1,88 @@
+#include "capture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "image.h"
+
+// Worker side
+static void write_frame(void* arg) {
+    struct CaptureWrite* write = arg;
+    if (!image_write_ppm(write->path, write->pixels, write->width, write->height, 1)) write->failed = 1;
+}
+
+// Wait for the writer and give its buffer back to GL
+static void release_mapped(FrameCapture* capture) {
+    pool_wait(capture->writer);
+    if (capture->write.failed) capture->failed = 1;
+    capture->write.failed = 0;
+    if (capture->mapped) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->mapped);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        capture->mapped = 0;
+    }
+}
+
+// Map the oldest frame still in flight and hand it to the writer
+static void retire_frame(FrameCapture* capture) {
+    release_mapped(capture);
+    GLuint pbo = capture->pbo[capture->retired % CAPTURE_SLOTS];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    const unsigned char* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)capture->width * capture->height * 4,
+                                                   GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!pixels) {
+        fprintf(stderr, "Failed to map frame %d\n", capture->retired);
+        capture->failed = 1;
+    } else {
+        capture->mapped = pbo;
+        capture->write.pixels = pixels;
+        capture->write.width = capture->width;
+        capture->write.height = capture->height;
+        snprintf(capture->write.path, sizeof(capture->write.path), "%s/frame_%05d.ppm", capture->dir, capture->retired);
+        pool_submit(capture->writer, write_frame, &capture->write);
+    }
+    capture->retired++;
+}
+
+int capture_init(FrameCapture* capture, const char* dir, int width, int height) {
+    memset(capture, 0, sizeof(*capture));
+    if (!image_make_dir(dir)) {
+        return 0;
+    }
+    snprintf(capture->dir, sizeof(capture->dir), "%s", dir);
+    capture->width = width;
+    capture->height = height;
+
+    glGenBuffers(CAPTURE_SLOTS, capture->pbo);
+    for (int i = 0; i < CAPTURE_SLOTS; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->pbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    capture->writer = pool_create(1);
+    return 1;
+}
+
+void capture_frame(FrameCapture* capture) {
+    // The slot may still be mapped from the frame the writer is on
+    int slot = capture->frame % CAPTURE_SLOTS;
+    if (capture->mapped == capture->pbo[slot]) release_mapped(capture);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->pbo[slot]);
+    glReadPixels(0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    capture->frame++;
+
+    // Keep CAPTURE_SLOTS-1 frames in flight
+    if (capture->frame - capture->retired >= CAPTURE_SLOTS) retire_frame(capture);
+}
+
+int capture_finish(FrameCapture* capture) {
+    while (capture->retired < capture->frame) retire_frame(capture);
+    release_mapped(capture);
+    pool_destroy(capture->writer);
+    glDeleteBuffers(CAPTURE_SLOTS, capture->pbo);
+    int ok = !capture->failed;
+    memset(capture, 0, sizeof(*capture));
+    return ok;
+}
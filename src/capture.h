@@ -0,0 +1,38 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <glad/glad.h>
+#include "pool.h"
+
+// Frame Capture
+// Reads the framebuffer back into a ring of pixel buffers, so glReadPixels returns at once and a frame
+// is only mapped CAPTURE_SLOTS-1 frames later when the GPU is long done with it.
+// Mapped frames are written as numbered PPM files on a worker thread while the next frames render.
+
+#define CAPTURE_SLOTS 3
+
+typedef struct {
+    struct CaptureWrite {
+        const unsigned char* pixels;	// Mapped RGBA rows, bottom up
+        int width, height;
+        char path[600];
+        int failed;
+    } write;
+    GLuint pbo[CAPTURE_SLOTS];
+    int width, height;
+    char dir[512];
+    int frame;			// Frames captured so far
+    int retired;		// Frames handed to the writer so far
+    GLuint mapped;		// Buffer the writer is reading from, 0 if none
+    WorkerPool* writer;
+    int failed;
+} FrameCapture;
+
+// Frames go to dir/frame_00000.ppm onwards, dir is created if missing. 0 on failure
+int capture_init(FrameCapture* capture, const char* dir, int width, int height);
+// Queue a readback of the bound read framebuffer
+void capture_frame(FrameCapture* capture);
+// Write out every queued frame and free everything, 0 if any frame failed to write
+int capture_finish(FrameCapture* capture);
+
+#endif
@@ -0,0 +1,140 @@
+#include "gallery.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "math4d.h"
+#include "mathnd.h"
+
+// Golden angle, keeps neighbouring cells visibly out of step
+#define PHASE_STEP 2.39996323f
+
+void gallery_init(Gallery* gallery, GLuint program, int shape_count) {
+    memset(gallery, 0, sizeof(*gallery));
+    gallery->program = program;
+    gallery->capacity = shape_count;
+    gallery->order = malloc(sizeof(int) * shape_count);
+    gallery->slots = malloc(sizeof(float) * 4 * GALLERY_SLOT_TEXELS * shape_count);
+    gallery->starts = malloc(sizeof(GLint) * shape_count);
+    gallery->counts = malloc(sizeof(GLsizei) * shape_count);
+    gallery->offsets = malloc(sizeof(void*) * shape_count);
+    gallery->base_vertices = malloc(sizeof(GLint) * shape_count);
+
+    glGenBuffers(1, &gallery->slot_buffer);
+    glGenBuffers(1, &gallery->start_buffer);
+    glGenTextures(1, &gallery->slot_texture);
+    glGenTextures(1, &gallery->start_texture);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, gallery->slot_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(float) * 4 * GALLERY_SLOT_TEXELS * (shape_count > 0 ? shape_count : 1), NULL, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, gallery->slot_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, gallery->slot_buffer);
+
+    glBindBuffer(GL_TEXTURE_BUFFER, gallery->start_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(GLint) * (shape_count > 0 ? shape_count : 1), NULL, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, gallery->start_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, gallery->start_buffer);
+
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "uSlots"), 0);
+    glUniform1i(glGetUniformLocation(program, "uStarts"), 1);
+    gallery->range_count_loc = glGetUniformLocation(program, "uRangeCount");
+}
+
+void gallery_destroy(Gallery* gallery) {
+    glDeleteTextures(1, &gallery->slot_texture);
+    glDeleteTextures(1, &gallery->start_texture);
+    glDeleteBuffers(1, &gallery->slot_buffer);
+    glDeleteBuffers(1, &gallery->start_buffer);
+    free(gallery->order);
+    free(gallery->slots);
+    free(gallery->starts);
+    free(gallery->counts);
+    free(gallery->offsets);
+    free(gallery->base_vertices);
+    memset(gallery, 0, sizeof(*gallery));
+}
+
+static const Residency* sort_res;
+
+static int by_base_vertex(const void* a, const void* b) {
+    GLint va = sort_res->shapes[*(const int*)a].base_vertex;
+    GLint vb = sort_res->shapes[*(const int*)b].base_vertex;
+    return (va > vb) - (va < vb);
+}
+
+void gallery_draw(Gallery* gallery, const Residency* res, const ShapeLibrary* library, WorkerPool* pool,
+                  const Projection* proj, Vertex* shadow,
+                  float angle_x, float angle_y, float angle_xw, float angle_yw, float angle_zw, float aspect) {
+    // Ranges must be ascending for the shader's binary search
+    int count = 0;
+    for (int i = 0; i < res->count && count < gallery->capacity; i++) {
+        if (res->shapes[i].resident && res->shapes[i].index_count > 0) gallery->order[count++] = i;
+    }
+    if (count == 0) return;
+    sort_res = res;
+    qsort(gallery->order, count, sizeof(int), by_base_vertex);
+
+    // Grid with roughly square cells on screen, one per library shape, filled row by row from the top left
+    int cols = (int)ceilf(sqrtf(res->count * aspect));
+    if (cols < 1) cols = 1;
+    int rows = (res->count + cols - 1) / cols;
+    float cell_w = 2.0f / cols, cell_h = 2.0f / rows;
+    // Projected shapes reach about +-1, leave some margin
+    float scale = 0.45f * (cell_w < cell_h ? cell_w : cell_h);
+
+    for (int r = 0; r < count; r++) {
+        int idx = gallery->order[r];
+        const Polyhedron* shape = &library->entries[idx].shape;
+        float phase = idx * PHASE_STEP;
+        Mat4 m = view_transform(shape->is_4d, angle_x + phase, angle_y + phase,
+                                angle_xw + phase, angle_yw + phase, angle_zw + phase);
+        if (shape->coords) {
+            MatN m_n = view_transform_n(shape->dim, angle_x + phase, angle_y + phase,
+                                        angle_xw + phase, angle_yw + phase, angle_zw + phase);
+            residency_update_shadow(res, idx, shape, pool, &m_n, proj, shadow, NULL, NULL);
+            m = mat4_identity();
+        }
+        float* slot = &gallery->slots[r * 4 * GALLERY_SLOT_TEXELS];
+        memcpy(slot, m.m, sizeof(m.m));
+        int col = idx % cols, row = idx / cols;
+        // Cells follow library order, not buffer order, so the grid is stable as shapes move in the buffer
+        slot[16] = -1.0f + cell_w * (col + 0.5f);
+        slot[17] = 1.0f - cell_h * (row + 0.5f);
+        slot[18] = scale;
+        slot[19] = (float)shape->is_4d;
+        gallery->starts[r] = res->shapes[idx].base_vertex;
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, gallery->slot_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(float) * 4 * GALLERY_SLOT_TEXELS * gallery->capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(float) * 4 * GALLERY_SLOT_TEXELS * count, gallery->slots);
+    glBindBuffer(GL_TEXTURE_BUFFER, gallery->start_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(GLint) * gallery->capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(GLint) * count, gallery->starts);
+
+    glUseProgram(gallery->program);
+    glUniform1i(gallery->range_count_loc, count);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, gallery->slot_texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, gallery->start_texture);
+    glActiveTexture(GL_TEXTURE0);
+
+    // One draw call per index width in use
+    static const GLenum types[] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, GL_UNSIGNED_INT };
+    for (int t = 0; t < 3; t++) {
+        GLsizei draws = 0;
+        for (int r = 0; r < count; r++) {
+            const GpuShape* g = &res->shapes[gallery->order[r]];
+            if (g->index_type != types[t]) continue;
+            gallery->counts[draws] = g->index_count;
+            gallery->offsets[draws] = (const void*)g->index_offset;
+            gallery->base_vertices[draws] = g->base_vertex;
+            draws++;
+        }
+        if (draws) {
+            glMultiDrawElementsBaseVertex(GL_LINES, gallery->counts, types[t], (const void* const*)gallery->offsets,
+                                          draws, gallery->base_vertices);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef GALLERY_H
+#define GALLERY_H
+
+#include <glad/glad.h>
+#include "library.h"
+#include "residency.h"
+#include "transform.h"
+
+// Gallery
+// Every resident shape drawn at once in a grid, each at its own rotation phase.
+// One multi-draw per index width; the vertex shader finds its shape from gl_VertexID
+// (which includes the base vertex) and reads that shape's transform and cell from a texture buffer.
+// Shapes above 4D are rotated on the CPU each frame and their 4D shadow uploaded in place, with an
+// identity transform in their slot.
+
+#define GALLERY_SLOT_TEXELS 5		// Four transform rows, then cell x, cell y, scale, is_4d
+
+typedef struct {
+    GLuint program;
+    GLint range_count_loc;
+    GLuint slot_buffer, slot_texture;	// RGBA32F, GALLERY_SLOT_TEXELS per shape
+    GLuint start_buffer, start_texture;	// R32I, first vertex of each shape, ascending
+    int capacity;
+    int* order;				// Resident shapes sorted by base vertex
+    float* slots;
+    GLint* starts;
+    GLsizei* counts;
+    const void** offsets;
+    GLint* base_vertices;
+} Gallery;
+
+// program must declare the samplers uSlots and uStarts and the int uRangeCount
+void gallery_init(Gallery* gallery, GLuint program, int shape_count);
+void gallery_destroy(Gallery* gallery);
+
+// Draw all shapes resident in res (SOURCE mode) at the given view angles, leaves the gallery program bound.
+// shadow holds the largest shape above 4D, pool (may be NULL) projects them
+void gallery_draw(Gallery* gallery, const Residency* res, const ShapeLibrary* library, WorkerPool* pool,
+                  const Projection* proj, Vertex* shadow,
+                  float angle_x, float angle_y, float angle_xw, float angle_yw, float angle_zw, float aspect);
+
+#endif
@@ -0,0 +1,306 @@
+#include "generators.h"
+#include "wythoff.h"
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TWO_PI 6.28318530718f
+
+// Exact-size storage for a shape of dim dimensions about to be filled in, 0 if the counts don't fit an int or memory.
+// Above POLY_MAX_DIM the shape is stored as its 4D shadow
+static int alloc_shape(Polyhedron* shape, int dim, long long v_count, long long e_count) {
+    if (v_count < 0 || e_count < 0 || v_count > INT_MAX || e_count > INT_MAX) {
+        fprintf(stderr, "Shape %s is too large: %lld vertices, %lld edges\n", shape->name, v_count, e_count);
+        return 0;
+    }
+    shape->dim = dim > POLY_MAX_DIM ? 4 : dim;
+    shape->is_4d = shape->dim >= 4;
+    shape->v_count = (int)v_count;
+    shape->e_count = (int)e_count;
+    if (shape->dim > 4) shape->coords = malloc(sizeof(float) * shape->dim * (size_t)(v_count > 0 ? v_count : 1));
+    else shape->vertices = malloc(sizeof(Vertex) * (size_t)(v_count > 0 ? v_count : 1));
+    shape->edges = malloc(sizeof(Edge) * (size_t)(e_count > 0 ? e_count : 1));
+    if ((!shape->vertices && !shape->coords) || !shape->edges) {
+        fprintf(stderr, "Out of memory for shape %s: %lld vertices, %lld edges\n", shape->name, v_count, e_count);
+        free_shape(shape);
+        return 0;
+    }
+    return 1;
+}
+
+// Store vertex i from its n coordinates. Past POLY_MAX_DIM it is projected onto rows 1-4 of the n-point
+// DCT basis, which are orthonormal and mix every axis in, so the shadow keeps the polytope's symmetry visible
+static void set_vertex(Polyhedron* shape, int i, const float* coords, int n) {
+    if (shape->coords) {
+        memcpy(&shape->coords[(size_t)i * n], coords, sizeof(float) * n);
+        return;
+    }
+    float out[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    if (n <= 4) {
+        for (int k = 0; k < n; k++) out[k] = coords[k];
+    }
+    else {
+        float norm = sqrtf(2.0f / n);
+        for (int r = 0; r < 4; r++) {
+            for (int k = 0; k < n; k++) out[r] += coords[k] * norm * cosf(3.14159265359f * (k + 0.5f) * (r + 1) / n);
+        }
+    }
+    shape->vertices[i] = (Vertex){ out[0], out[1], out[2], out[3] };
+}
+
+// n-cube with corners at +-1 like the tesseract file, edges join corners one coordinate apart
+static int build_hypercube(const int* params, Polyhedron* shape) {
+    int n = params[0];
+    long long v_count = 1LL << n;
+    if (!alloc_shape(shape, n < 3 ? 3 : n, v_count, v_count * n / 2)) return 0;
+
+    // Shrink higher dimensions so the projection stays about the tesseract's size
+    float side = n > 4 ? sqrtf(4.0f / n) : 1.0f;
+    int e = 0;
+    for (int i = 0; i < shape->v_count; i++) {
+        float coords[GEN_MAX_DIM];
+        for (int k = 0; k < n; k++) coords[k] = (i >> (n - 1 - k)) & 1 ? side : -side;
+        set_vertex(shape, i, coords, n);
+        for (int k = 0; k < n; k++) {
+            int j = i ^ (1 << k);
+            if (j > i) shape->edges[e++] = (Edge){ i, j };
+        }
+    }
+    return 1;
+}
+
+// Regular n-simplex, circumradius 1.5, every pair of vertices joined
+static int build_simplex(const int* params, Polyhedron* shape) {
+    int n = params[0];
+    if (!alloc_shape(shape, n < 3 ? 3 : n, n + 1, (long long)(n + 1) * n / 2)) return 0;
+
+    // Unit vectors with pairwise dot products -1/n, one new axis per vertex
+    float coords[GEN_MAX_DIM + 1][GEN_MAX_DIM];
+    memset(coords, 0, sizeof(coords));
+    for (int d = 0; d < n; d++) {
+        float sum = 0.0f;
+        for (int j = 0; j < d; j++) sum += coords[d][j] * coords[d][j];
+        coords[d][d] = sqrtf(1.0f - sum);
+        for (int i = d + 1; i <= n; i++) {
+            float dot = -1.0f / n;
+            for (int j = 0; j < d; j++) dot -= coords[i][j] * coords[d][j];
+            coords[i][d] = dot / coords[d][d];
+        }
+    }
+    int e = 0;
+    for (int i = 0; i <= n; i++) {
+        for (int k = 0; k < n; k++) coords[i][k] *= 1.5f;
+        set_vertex(shape, i, coords[i], n);
+        for (int j = i + 1; j <= n; j++) shape->edges[e++] = (Edge){ i, j };
+    }
+    return 1;
+}
+
+// n-orthoplex, vertices at +-1.5 on each axis, joined unless opposite
+static int build_cross(const int* params, Polyhedron* shape) {
+    int n = params[0];
+    if (!alloc_shape(shape, n < 3 ? 3 : n, 2 * n, 2LL * n * (n - 1))) return 0;
+
+    int e = 0;
+    for (int i = 0; i < 2 * n; i++) {
+        float coords[GEN_MAX_DIM] = { 0.0f };
+        coords[i / 2] = i % 2 ? -1.5f : 1.5f;
+        set_vertex(shape, i, coords, n);
+        for (int j = i + 1; j < 2 * n; j++) {
+            if (j / 2 != i / 2) shape->edges[e++] = (Edge){ i, j };
+        }
+    }
+    return 1;
+}
+
+// Latitude/longitude sphere of radius 1.5: u segments around, v from pole to pole
+static int build_sphere(const int* params, Polyhedron* shape) {
+    int u = params[0], v = params[1];
+    long long rings = v - 1;
+    if (!alloc_shape(shape, 3, u * rings + 2, u * rings + (long long)u * v)) return 0;
+
+    // North pole, rings of u, south pole
+    int south = shape->v_count - 1;
+    shape->vertices[0] = (Vertex){ 0.0f, 1.5f, 0.0f, 0.0f };
+    shape->vertices[south] = (Vertex){ 0.0f, -1.5f, 0.0f, 0.0f };
+    int e = 0;
+    for (int r = 0; r < rings; r++) {
+        float phi = 3.14159265359f * (r + 1) / v;
+        for (int i = 0; i < u; i++) {
+            float theta = TWO_PI * i / u;
+            int idx = 1 + r * u + i;
+            shape->vertices[idx] = (Vertex){ 1.5f * sinf(phi) * cosf(theta), 1.5f * cosf(phi), 1.5f * sinf(phi) * sinf(theta), 0.0f };
+            shape->edges[e++] = (Edge){ idx, 1 + r * u + (i + 1) % u };
+            shape->edges[e++] = (Edge){ r == 0 ? 0 : idx - u, idx };
+            if (r == rings - 1) shape->edges[e++] = (Edge){ idx, south };
+        }
+    }
+    return 1;
+}
+
+// Ring torus, major radius 1.2 and minor 0.5
+static int build_torus(const int* params, Polyhedron* shape) {
+    int u = params[0], v = params[1];
+    if (!alloc_shape(shape, 3, (long long)u * v, 2LL * u * v)) return 0;
+
+    for (int i = 0; i < u; i++) {
+        for (int j = 0; j < v; j++) {
+            float a = TWO_PI * i / u, b = TWO_PI * j / v;
+            int idx = i * v + j;
+            float ring = 1.2f + 0.5f * cosf(b);
+            shape->vertices[idx] = (Vertex){ ring * cosf(a), 0.5f * sinf(b), ring * sinf(a), 0.0f };
+            shape->edges[2*idx] = (Edge){ idx, i * v + (j + 1) % v };
+            shape->edges[2*idx+1] = (Edge){ idx, ((i + 1) % u) * v + j };
+        }
+    }
+    return 1;
+}
+
+// Flat torus in 4D, the product of two unit circles, like stressgen writes
+static int build_clifford(const int* params, Polyhedron* shape) {
+    int u = params[0], v = params[1];
+    if (!alloc_shape(shape, 4, (long long)u * v, 2LL * u * v)) return 0;
+
+    for (int i = 0; i < u; i++) {
+        for (int j = 0; j < v; j++) {
+            float a = TWO_PI * i / u, b = TWO_PI * j / v;
+            int idx = i * v + j;
+            shape->vertices[idx] = (Vertex){ cosf(a), sinf(a), cosf(b), sinf(b) };
+            shape->edges[2*idx] = (Edge){ idx, i * v + (j + 1) % v };
+            shape->edges[2*idx+1] = (Edge){ idx, ((i + 1) % u) * v + j };
+        }
+    }
+    return 1;
+}
+
+// Mobius strip of radius 1.2 and width 1, u steps around and v across. The last column joins the first flipped
+static int build_mobius(const int* params, Polyhedron* shape) {
+    int u = params[0], v = params[1];
+    if (!alloc_shape(shape, 3, (long long)u * v, (long long)u * v + (long long)u * (v - 1))) return 0;
+
+    int e = 0;
+    for (int i = 0; i < u; i++) {
+        float a = TWO_PI * i / u;
+        for (int j = 0; j < v; j++) {
+            float s = (float)j / (v - 1) - 0.5f;
+            float ring = 1.2f + s * cosf(a * 0.5f);
+            int idx = i * v + j;
+            shape->vertices[idx] = (Vertex){ ring * cosf(a), s * sinf(a * 0.5f), ring * sinf(a), 0.0f };
+            shape->edges[e++] = (Edge){ idx, i + 1 < u ? idx + v : v - 1 - j };
+            if (j + 1 < v) shape->edges[e++] = (Edge){ idx, idx + 1 };
+        }
+    }
+    return 1;
+}
+
+// 3-sphere of radius 1.5 in Hopf coordinates: a layers of eta between the two great circles,
+// each a b x c torus. Tori are joined layer to layer, nothing degenerates at the ends
+static int build_hypersphere(const int* params, Polyhedron* shape) {
+    int a = params[0], b = params[1], c = params[2];
+    // Each value is at most GEN_MAX_SIDE, so the counts stay far inside a long long for alloc_shape to check
+    long long layer = (long long)b * c;
+    if (!alloc_shape(shape, 4, a * layer, 3 * a * layer - layer)) return 0;
+
+    int e = 0;
+    for (int i = 0; i < a; i++) {
+        float eta = 1.57079632679f * (i + 0.5f) / a;
+        for (int j = 0; j < b; j++) {
+            for (int k = 0; k < c; k++) {
+                float xi1 = TWO_PI * j / b, xi2 = TWO_PI * k / c;
+                int idx = (int)(i * layer) + j * c + k;
+                shape->vertices[idx] = (Vertex){ 1.5f * cosf(xi1) * sinf(eta), 1.5f * sinf(xi1) * sinf(eta),
+                                                 1.5f * cosf(xi2) * cosf(eta), 1.5f * sinf(xi2) * cosf(eta) };
+                shape->edges[e++] = (Edge){ idx, (int)(i * layer) + ((j + 1) % b) * c + k };
+                shape->edges[e++] = (Edge){ idx, (int)(i * layer) + j * c + (k + 1) % c };
+                if (i + 1 < a) shape->edges[e++] = (Edge){ idx, idx + (int)layer };
+            }
+        }
+    }
+    return 1;
+}
+
+// Uniform 4-polytope from the Coxeter diagram o-P-o-Q-o-R-o, RINGS has a 0/1 digit per node (see wythoff.h)
+static int build_wythoff(const int* params, Polyhedron* shape) {
+    int ringed[4], rings = params[3];
+    for (int k = 3; k >= 0; k--, rings /= 10) ringed[k] = rings % 10;
+    if (rings != 0 || ringed[0] > 1 || ringed[1] > 1 || ringed[2] > 1 || ringed[3] > 1) {
+        fprintf(stderr, "Rings are four digits of 0 or 1 like 1000 or 0110, not %d\n", params[3]);
+        return 0;
+    }
+    // Leading zeros matter here
+    snprintf(shape->name, sizeof(shape->name), "wythoff%dx%dx%dx%04d", params[0], params[1], params[2], params[3]);
+    return wythoff_build(params, ringed, shape);
+}
+
+typedef struct {
+    const char* name;
+    const char* usage;			// Parameters after the colon
+    int param_count;
+    int defaults[GEN_MAX_PARAMS];	// For parameters left out
+    int min_value, max_value;	// The lower bound keeps every edge between two different vertices
+    int (*build)(const int* params, Polyhedron* shape);
+} Generator;
+
+static const Generator generators[] = {
+    { "hypercube", "N", 1, { 4 }, 2, GEN_MAX_DIM, build_hypercube },
+    { "simplex", "N", 1, { 4 }, 2, GEN_MAX_DIM, build_simplex },
+    { "cross", "N", 1, { 4 }, 2, GEN_MAX_DIM, build_cross },
+    { "sphere", "AROUNDxDOWN", 2, { 32, 32 }, 3, GEN_MAX_SIDE, build_sphere },
+    { "torus", "AROUNDxACROSS", 2, { 32, 32 }, 3, GEN_MAX_SIDE, build_torus },
+    { "clifford", "AROUNDxAROUND", 2, { 32, 32 }, 3, GEN_MAX_SIDE, build_clifford },
+    { "mobius", "AROUNDxACROSS", 2, { 64, 8 }, 3, GEN_MAX_SIDE, build_mobius },
+    { "hypersphere", "LAYERSxAROUNDxAROUND", 3, { 8, 24, 24 }, 3, GEN_MAX_SIDE, build_hypersphere },
+    { "wythoff", "P,Q,R,RINGS", 4, { 5, 3, 3, 1000 }, 0, 1111, build_wythoff },
+};
+#define GENERATOR_COUNT (int)(sizeof(generators) / sizeof(generators[0]))
+
+void generator_list(FILE* out) {
+    for (int i = 0; i < GENERATOR_COUNT; i++) {
+        const Generator* gen = &generators[i];
+        char form[64];
+        snprintf(form, sizeof(form), "%s:%s", gen->name, gen->usage);
+        fprintf(out, "   %-34s default %s:", form, gen->name);
+        for (int p = 0; p < gen->param_count; p++) fprintf(out, p ? "x%d" : "%d", gen->defaults[p]);
+        fprintf(out, "\n");
+    }
+}
+
+int generate_shape(const char* spec, Polyhedron* shape) {
+    memset(shape, 0, sizeof(*shape));
+    const char* colon = strchr(spec, ':');
+    size_t name_length = colon ? (size_t)(colon - spec) : strlen(spec);
+
+    for (int i = 0; i < GENERATOR_COUNT; i++) {
+        const Generator* gen = &generators[i];
+        if (strlen(gen->name) != name_length || strncmp(gen->name, spec, name_length) != 0) continue;
+
+        // Numbers separated by x or commas, defaults for the rest
+        int params[GEN_MAX_PARAMS];
+        memcpy(params, gen->defaults, sizeof(params));
+        const char* cursor = colon ? colon + 1 : "";
+        for (int count = 0; *cursor; count++) {
+            char* end;
+            long value = strtol(cursor, &end, 10);
+            if (end == cursor || count == gen->param_count || value < gen->min_value || value > gen->max_value ||
+                (*end != '\0' && *end != 'x' && *end != ',')) {
+                fprintf(stderr, "Bad generator spec \"%s\", expected %s:%s with each value from %d to %d\n",
+                        spec, gen->name, gen->usage, gen->min_value, gen->max_value);
+                return 0;
+            }
+            params[count] = (int)value;
+            cursor = *end ? end + 1 : end;
+        }
+
+        // Named like "sphere200x200", cut to fit
+        int written = snprintf(shape->name, sizeof(shape->name), "%s", gen->name);
+        for (int p = 0; p < gen->param_count && written < (int)sizeof(shape->name); p++) {
+            written += snprintf(shape->name + written, sizeof(shape->name) - written, p ? "x%d" : "%d", params[p]);
+        }
+        return gen->build(params, shape);
+    }
+
+    fprintf(stderr, "No generator called \"%.*s\", available:\n", (int)name_length, spec);
+    generator_list(stderr);
+    return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <stdio.h>
+#include "shapes.h"
+
+// Shape Generators
+// Build shapes in memory from a spec string like "hypercube:6" or "sphere:200x200", no files involved.
+// Counts are worked out before anything is allocated, so vertices and edges get exactly the size they need.
+// Polytopes keep up to POLY_MAX_DIM dimensions, higher ones are stored as their shadow in 4D.
+
+#define GEN_MAX_DIM 24
+#define GEN_MAX_PARAMS 4
+#define GEN_MAX_SIDE 32767		// Largest count per direction for surfaces and hyperspheres, two of them fit an int
+
+// Build the shape a spec describes, 0 with a message on stderr if the spec is bad or it doesn't fit in memory
+int generate_shape(const char* spec, Polyhedron* shape);
+// One line per generator and its parameters
+void generator_list(FILE* out);
+
+#endif
@@ -0,0 +1,101 @@
+#include "headless.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef POLYHEDRA_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+GLADloadproc headless_loader(void) {
+    return (GLADloadproc)eglGetProcAddress;
+}
+
+int headless_init(Headless* headless, int width, int height) {
+    memset(headless, 0, sizeof(*headless));
+
+    // Surfaceless needs no window system at all, fall back to the default display elsewhere
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display) display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        fprintf(stderr, "Failed to initialize EGL (error 0x%x)\n", eglGetError());
+        return 0;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "EGL has no desktop OpenGL\n");
+        eglTerminate(display);
+        return 0;
+    }
+
+    // No surface, so no config either (EGL_KHR_no_config_context, always there with surfaceless)
+    const EGLint attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, (EGLConfig)0, EGL_NO_CONTEXT, attributes);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        fprintf(stderr, "Failed to create an OpenGL 3.3 context (error 0x%x)\n", eglGetError());
+        if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        eglTerminate(display);
+        return 0;
+    }
+    headless->display = display;
+    headless->context = context;
+
+    if (!gladLoadGLLoader(headless_loader())) {
+        fprintf(stderr, "Failed to initialize GLAD\n");
+        headless_destroy(headless);
+        return 0;
+    }
+
+    // Everything renders into this instead of a window
+    headless->width = width;
+    headless->height = height;
+    glGenRenderbuffers(1, &headless->color);
+    glBindRenderbuffer(GL_RENDERBUFFER, headless->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenFramebuffers(1, &headless->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, headless->fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless->color);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Offscreen framebuffer is incomplete\n");
+        headless_destroy(headless);
+        return 0;
+    }
+    return 1;
+}
+
+void headless_destroy(Headless* headless) {
+    if (headless->fbo) glDeleteFramebuffers(1, &headless->fbo);
+    if (headless->color) glDeleteRenderbuffers(1, &headless->color);
+    if (headless->context) {
+        eglMakeCurrent(headless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(headless->display, headless->context);
+    }
+    if (headless->display) eglTerminate(headless->display);
+    memset(headless, 0, sizeof(*headless));
+}
+
+#else
+
+GLADloadproc headless_loader(void) {
+    return NULL;
+}
+
+int headless_init(Headless* headless, int width, int height) {
+    (void)width;
+    (void)height;
+    memset(headless, 0, sizeof(*headless));
+    fprintf(stderr, "Headless rendering needs EGL, which this build doesn't have\n");
+    return 0;
+}
+
+void headless_destroy(Headless* headless) {
+    memset(headless, 0, sizeof(*headless));
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+
+// Headless Context
+// An OpenGL 3.3 core context without a display (EGL on Mesa's surfaceless platform, so llvmpipe works on
+// machines without a GPU) rendering into an offscreen framebuffer of a fixed size.
+// Only available where the build found EGL (POLYHEDRA_EGL), headless_init fails otherwise.
+
+typedef struct {
+    void* display;
+    void* context;
+    GLuint fbo, color;
+    int width, height;
+} Headless;
+
+// Creates the context, loads GL through glad and leaves the framebuffer bound, 0 on failure
+int headless_init(Headless* headless, int width, int height);
+void headless_destroy(Headless* headless);
+// Entry point loader for the current headless context
+GLADloadproc headless_loader(void);
+
+#endif
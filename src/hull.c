@@ -0,0 +1,904 @@
+#include "hull.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timer.h"
+
+const char* hull_phase_names[HULL_PHASES] = { "simplex", "assign", "expand", "faces" };
+
+// Two's complement 128-bit integer that wraps like unsigned arithmetic, so it's exact while results fit.
+// Grid coordinates are below 2^28: normals stay under 2^90 and sides of planes under 2^124
+typedef struct {
+    uint64_t lo, hi;
+} Wide;
+
+static inline Wide wide(int64_t v) {
+    return (Wide){ (uint64_t)v, v < 0 ? ~0ULL : 0 };
+}
+
+static inline Wide wide_add(Wide a, Wide b) {
+    Wide r = { a.lo + b.lo, a.hi + b.hi };
+    r.hi += r.lo < a.lo;
+    return r;
+}
+
+static inline Wide wide_sub(Wide a, Wide b) {
+    Wide r = { a.lo - b.lo, a.hi - b.hi };
+    r.hi -= a.lo < b.lo;
+    return r;
+}
+
+static inline Wide wide_mul(Wide a, int64_t b) {
+    uint64_t ub = (uint64_t)b;
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 low = (unsigned __int128)a.lo * ub;
+    Wide r = { (uint64_t)low, (uint64_t)(low >> 64) };
+#else
+    uint64_t a0 = (uint32_t)a.lo, a1 = a.lo >> 32, b0 = (uint32_t)ub, b1 = ub >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0;
+    uint64_t middle = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    Wide r = { (middle << 32) | (uint32_t)p00, a1 * b1 + (p01 >> 32) + (p10 >> 32) + (middle >> 32) };
+#endif
+    r.hi += a.hi * ub - (b < 0 ? a.lo : 0);
+    return r;
+}
+
+static inline int wide_sign(Wide a) {
+    return (int64_t)a.hi < 0 ? -1 : (a.hi | a.lo) != 0;
+}
+
+static inline double wide_double(Wide a) {
+    if ((int64_t)a.hi < 0) {
+        a = wide_sub(wide(0), a);
+        return -((double)a.hi * 18446744073709551616.0 + (double)a.lo);
+    }
+    return (double)a.hi * 18446744073709551616.0 + (double)a.lo;
+}
+
+typedef struct {
+    Wide normal[4];			// Exact, pointing out
+    Wide offset;			// normal . p - offset is positive outside, zero on the plane
+    double unit[4];			// normal scaled to length one
+    double scale;			// 1 / |normal|, turns sides into grid distances
+} Plane;
+
+typedef struct {
+    int v[4];				// Vertex indices
+    int n[4];				// Neighbouring facet across the ridge opposite v[k]
+    Plane plane;
+    int outside;			// First point of the outside set, -1 if empty
+    int furthest;
+    double furthest_distance;
+    int stamp;				// Last insertion that tested it
+    int visible;			// What that test found, on the plane counts
+    int alive;
+} Facet;
+
+// New facet over one horizon ridge: the visible facet's vertices without v[skip], then the eye
+typedef struct {
+    int facet, skip;
+    int v[4];
+    int n[4];				// Neighbouring cones until committed
+    Plane plane;
+    int created;			// Facet it became
+} Cone;
+
+// Ridge through the eye, found once per cone sharing it
+typedef struct {
+    uint64_t key;			// Packed vertex pair + 1, 0 for an empty slot
+    int cone, slot;			// cone -1 once the second cone has been matched
+} RidgeSlot;
+
+typedef struct {
+    const int32_t* grid;	// 4 per point
+    int count;
+    int64_t interior[4];	// Sum of the starting simplex, five times a point inside
+    double coplanar;		// Rounding tolerance in grid units, 0 for exact cells
+    WorkerPool* pool;
+
+    Facet* facets;
+    int facet_count, facet_capacity;
+    int* spare;				// Dead facet slots for reuse
+    int spare_count, spare_capacity;
+    int* next;				// Next point in the same outside set
+    int* pending;			// Facets that were given outside points, most recent last
+    int pending_count, pending_capacity;
+    int stamp;
+
+    // Scratch for one insertion
+    int* visible;
+    int visible_count, visible_capacity;
+    Cone* cones;
+    int cone_count, cone_capacity;
+    RidgeSlot* ridges;
+    size_t ridge_capacity;
+    int* moved;				// Points of the visible facets to hand on
+    int* target;			// The new facet each goes to, -1 for inside
+    double* target_distance;
+    int moved_count, moved_capacity;
+} Hull;
+
+// 0 if out of memory
+static int reserve(void** array, int* capacity, int needed, size_t size) {
+    if (needed <= *capacity) return 1;
+    int grown = *capacity ? *capacity : 64;
+    while (grown < needed) grown *= 2;
+    void* block = realloc(*array, size * grown);
+    if (!block) return 0;
+    *array = block;
+    *capacity = grown;
+    return 1;
+}
+
+static inline const int32_t* point(const Hull* hull, int p) {
+    return hull->grid + (size_t)p * 4;
+}
+
+static inline double dot4(const double* a, const double* b) {
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3];
+}
+
+static inline Wide side(const Hull* hull, const Plane* plane, int p) {
+    const int32_t* q = point(hull, p);
+    Wide sum = wide_mul(plane->normal[0], q[0]);
+    for (int k = 1; k < 4; k++) sum = wide_add(sum, wide_mul(plane->normal[k], q[k]));
+    return wide_sub(sum, plane->offset);
+}
+
+// Signed, in grid units
+static inline double distance(const Hull* hull, const Plane* plane, int p) {
+    return wide_double(side(hull, plane, p)) * plane->scale;
+}
+
+// Hyperplane through four points facing away from the interior, 0 if they're flat
+static int plane_through(const Hull* hull, const int* v, Plane* plane) {
+    const int32_t* a = point(hull, v[0]);
+    int64_t u[3][4];
+    for (int r = 0; r < 3; r++) {
+        for (int k = 0; k < 4; k++) u[r][k] = (int64_t)point(hull, v[r + 1])[k] - a[k];
+    }
+    // Generalised cross product, cofactors along the missing row
+    int zero = 1;
+    for (int k = 0; k < 4; k++) {
+        int c[3], m = 0;
+        for (int j = 0; j < 4; j++) {
+            if (j != k) c[m++] = j;
+        }
+        Wide minor = wide_mul(wide(u[1][c[1]] * u[2][c[2]] - u[1][c[2]] * u[2][c[1]]), u[0][c[0]]);
+        minor = wide_sub(minor, wide_mul(wide(u[1][c[0]] * u[2][c[2]] - u[1][c[2]] * u[2][c[0]]), u[0][c[1]]));
+        minor = wide_add(minor, wide_mul(wide(u[1][c[0]] * u[2][c[1]] - u[1][c[1]] * u[2][c[0]]), u[0][c[2]]));
+        plane->normal[k] = k % 2 ? wide_sub(wide(0), minor) : minor;
+        zero &= wide_sign(minor) == 0;
+    }
+    if (zero) return 0;
+    plane->offset = wide_mul(plane->normal[0], a[0]);
+    for (int k = 1; k < 4; k++) plane->offset = wide_add(plane->offset, wide_mul(plane->normal[k], a[k]));
+
+    Wide inward = wide_mul(plane->offset, -5);
+    for (int k = 0; k < 4; k++) inward = wide_add(inward, wide_mul(plane->normal[k], hull->interior[k]));
+    if (wide_sign(inward) > 0) {
+        for (int k = 0; k < 4; k++) plane->normal[k] = wide_sub(wide(0), plane->normal[k]);
+        plane->offset = wide_sub(wide(0), plane->offset);
+    }
+    double length = 0.0;
+    for (int k = 0; k < 4; k++) {
+        plane->unit[k] = wide_double(plane->normal[k]);
+        length += plane->unit[k] * plane->unit[k];
+    }
+    plane->scale = 1.0 / sqrt(length);
+    for (int k = 0; k < 4; k++) plane->unit[k] *= plane->scale;
+    return 1;
+}
+
+// Facet slot, reusing dead ones. -1 if out of memory
+static int new_facet(Hull* hull) {
+    if (hull->spare_count > 0) return hull->spare[--hull->spare_count];
+    if (!reserve((void**)&hull->facets, &hull->facet_capacity, hull->facet_count + 1, sizeof(Facet))) return -1;
+    return hull->facet_count++;
+}
+
+static int add_outside(Hull* hull, int f, int p, double d) {
+    Facet* facet = &hull->facets[f];
+    if (facet->outside < 0) {
+        if (!reserve((void**)&hull->pending, &hull->pending_capacity, hull->pending_count + 1, sizeof(int))) return 0;
+        hull->pending[hull->pending_count++] = f;
+        facet->furthest_distance = -1.0;
+    }
+    hull->next[p] = facet->outside;
+    facet->outside = p;
+    if (d > facet->furthest_distance) {
+        facet->furthest_distance = d;
+        facet->furthest = p;
+    }
+    return 1;
+}
+
+typedef struct {
+    Hull* hull;
+    const int* facets;
+    int facet_count;
+} AssignJob;
+
+// Pool task: first of the new facets each moved point lies outside of
+static void assign_range(void* ctx, int start, int end) {
+    AssignJob* job = ctx;
+    Hull* hull = job->hull;
+    for (int i = start; i < end; i++) {
+        hull->target[i] = -1;
+        for (int c = 0; c < job->facet_count; c++) {
+            const Plane* plane = &hull->facets[job->facets[c]].plane;
+            Wide outside = side(hull, plane, hull->moved[i]);
+            if (wide_sign(outside) > 0) {
+                hull->target[i] = job->facets[c];
+                hull->target_distance[i] = wide_double(outside) * plane->scale;
+                break;
+            }
+        }
+    }
+}
+
+// Hand the moved points to the facets they lie outside of, the others are inside for good
+static int assign_moved(Hull* hull, const int* facets, int facet_count) {
+    AssignJob job = { hull, facets, facet_count };
+    if (hull->pool && hull->moved_count >= HULL_PARALLEL_MIN) {
+        pool_parallel_for(hull->pool, hull->moved_count, (hull->moved_count + HULL_CHUNKS - 1) / HULL_CHUNKS, assign_range, &job);
+    } else {
+        assign_range(&job, 0, hull->moved_count);
+    }
+    for (int i = 0; i < hull->moved_count; i++) {
+        if (hull->target[i] >= 0 && !add_outside(hull, hull->target[i], hull->moved[i], hull->target_distance[i])) return 0;
+    }
+    return 1;
+}
+
+static int reserve_moved(Hull* hull, int needed) {
+    int capacity = hull->moved_capacity;
+    if (!reserve((void**)&hull->moved, &capacity, needed, sizeof(int))) return 0;
+    capacity = hull->moved_capacity;
+    if (!reserve((void**)&hull->target, &capacity, needed, sizeof(int))) return 0;
+    capacity = hull->moved_capacity;
+    if (!reserve((void**)&hull->target_distance, &capacity, needed, sizeof(double))) return 0;
+    hull->moved_capacity = capacity;
+    return 1;
+}
+
+// Facets the eye is outside of or on, walking out from one it's known to be outside of.
+// Taking the ones it's on too keeps every new facet clear of the eye's plane
+static int find_visible_from(Hull* hull, int eye, int start) {
+    hull->stamp++;
+    hull->visible_count = 0;
+    if (!reserve((void**)&hull->visible, &hull->visible_capacity, 1, sizeof(int))) return 0;
+    hull->visible[hull->visible_count++] = start;
+    hull->facets[start].stamp = hull->stamp;
+    hull->facets[start].visible = 1;
+    for (int i = 0; i < hull->visible_count; i++) {
+        const int* around = hull->facets[hull->visible[i]].n;
+        for (int k = 0; k < 4; k++) {
+            Facet* g = &hull->facets[around[k]];
+            if (g->stamp == hull->stamp) continue;
+            g->stamp = hull->stamp;
+            g->visible = wide_sign(side(hull, &g->plane, eye)) >= 0;
+            if (!g->visible) continue;
+            if (!reserve((void**)&hull->visible, &hull->visible_capacity, hull->visible_count + 1, sizeof(int))) return 0;
+            hull->visible[hull->visible_count++] = (int)(g - hull->facets);
+        }
+    }
+    return 1;
+}
+
+// The same by testing every facet, for the incremental fallback. *outside is 0 if the eye is in the hull
+static int find_visible_all(Hull* hull, int eye, int* outside) {
+    hull->stamp++;
+    hull->visible_count = 0;
+    *outside = 0;
+    for (int f = 0; f < hull->facet_count; f++) {
+        Facet* facet = &hull->facets[f];
+        if (!facet->alive) continue;
+        int sign = wide_sign(side(hull, &facet->plane, eye));
+        facet->stamp = hull->stamp;
+        facet->visible = sign >= 0;
+        *outside |= sign > 0;
+        if (!facet->visible) continue;
+        if (!reserve((void**)&hull->visible, &hull->visible_capacity, hull->visible_count + 1, sizeof(int))) return 0;
+        hull->visible[hull->visible_count++] = f;
+    }
+    return 1;
+}
+
+// Replace the visible facets by a cone from their horizon to eye. Everything is checked before the hull
+// changes: -1 if a new facet would be flat or the ridges don't pair up, 0 if out of memory
+static int add_point(Hull* hull, int eye) {
+    // One cone per ridge between a visible and a hidden facet
+    hull->cone_count = 0;
+    for (int i = 0; i < hull->visible_count; i++) {
+        const Facet* f = &hull->facets[hull->visible[i]];
+        for (int k = 0; k < 4; k++) {
+            const Facet* g = &hull->facets[f->n[k]];
+            if (g->stamp == hull->stamp && g->visible) continue;
+            if (!reserve((void**)&hull->cones, &hull->cone_capacity, hull->cone_count + 1, sizeof(Cone))) return 0;
+            Cone* cone = &hull->cones[hull->cone_count++];
+            cone->facet = hull->visible[i];
+            cone->skip = k;
+            for (int j = 0, m = 0; j < 4; j++) {
+                if (j != k) cone->v[m++] = f->v[j];
+            }
+            cone->v[3] = eye;
+            if (!plane_through(hull, cone->v, &cone->plane)) return -1;
+        }
+    }
+    // Every ridge through the eye has to join exactly two cones
+    size_t size = 16;
+    while (size < (size_t)hull->cone_count * 6) size <<= 1;
+    if (size > hull->ridge_capacity) {
+        RidgeSlot* ridges = realloc(hull->ridges, sizeof(RidgeSlot) * size);
+        if (!ridges) return 0;
+        hull->ridges = ridges;
+        hull->ridge_capacity = size;
+    }
+    memset(hull->ridges, 0, sizeof(RidgeSlot) * size);
+    for (int c = 0; c < hull->cone_count; c++) {
+        Cone* cone = &hull->cones[c];
+        for (int j = 0; j < 3; j++) {
+            int a = cone->v[j == 0 ? 1 : 0], b = cone->v[j == 2 ? 1 : 2];
+            uint64_t key = ((uint64_t)(a < b ? a : b) << 32 | (uint32_t)(a < b ? b : a)) + 1;
+            size_t slot = (key * 0x9e3779b97f4a7c15ULL >> 20) & (size - 1);
+            while (hull->ridges[slot].key && hull->ridges[slot].key != key) slot = (slot + 1) & (size - 1);
+            RidgeSlot* ridge = &hull->ridges[slot];
+            if (!ridge->key) {
+                *ridge = (RidgeSlot){ key, c, j };
+            } else if (ridge->cone >= 0) {
+                cone->n[j] = ridge->cone;
+                hull->cones[ridge->cone].n[ridge->slot] = c;
+                ridge->cone = -1;
+            } else {
+                return -1;
+            }
+        }
+    }
+    for (size_t slot = 0; slot < size; slot++) {
+        if (hull->ridges[slot].key && hull->ridges[slot].cone >= 0) return -1;
+    }
+
+    // Commit: new facets first so no visible slot is reused while it's still read
+    hull->moved_count = 0;
+    for (int c = 0; c < hull->cone_count; c++) {
+        int created = new_facet(hull);
+        if (created < 0) return 0;
+        hull->cones[c].created = created;
+    }
+    for (int c = 0; c < hull->cone_count; c++) {
+        const Cone* cone = &hull->cones[c];
+        int hidden = hull->facets[cone->facet].n[cone->skip];
+        Facet* facet = &hull->facets[cone->created];
+        memcpy(facet->v, cone->v, sizeof(facet->v));
+        for (int j = 0; j < 3; j++) facet->n[j] = hull->cones[cone->n[j]].created;
+        facet->n[3] = hidden;
+        facet->plane = cone->plane;
+        facet->outside = -1;
+        facet->stamp = 0;
+        facet->alive = 1;
+        Facet* g = &hull->facets[hidden];
+        for (int j = 0; j < 4; j++) {
+            if (g->n[j] == cone->facet) g->n[j] = cone->created;
+        }
+    }
+    for (int i = 0; i < hull->visible_count; i++) {
+        Facet* f = &hull->facets[hull->visible[i]];
+        for (int p = f->outside; p >= 0; p = hull->next[p]) {
+            if (p == eye) continue;
+            if (!reserve_moved(hull, hull->moved_count + 1)) return 0;
+            hull->moved[hull->moved_count++] = p;
+        }
+        f->alive = 0;
+        f->outside = -1;
+        if (!reserve((void**)&hull->spare, &hull->spare_capacity, hull->spare_count + 1, sizeof(int))) return 0;
+        hull->spare[hull->spare_count++] = hull->visible[i];
+    }
+
+    int* created = hull->visible;	// Free to reuse now
+    if (!reserve((void**)&hull->visible, &hull->visible_capacity, hull->cone_count, sizeof(int))) return 0;
+    created = hull->visible;
+    for (int c = 0; c < hull->cone_count; c++) created[c] = hull->cones[c].created;
+    return assign_moved(hull, created, hull->cone_count) ? 1 : 0;
+}
+
+typedef struct {
+    const Hull* hull;
+    const double* origin;
+    const double (*basis)[4];
+    int basis_count;
+    int best[HULL_CHUNKS];
+    double best_distance[HULL_CHUNKS];
+    int chunk_size;
+} FarthestJob;
+
+// Pool task: point furthest from the affine span of origin and the orthonormal basis, per chunk
+static void farthest_range(void* ctx, int start, int end) {
+    FarthestJob* job = ctx;
+    for (int chunk = start; chunk < end; chunk++) {
+        int first = chunk * job->chunk_size;
+        int last = first + job->chunk_size < job->hull->count ? first + job->chunk_size : job->hull->count;
+        job->best[chunk] = -1;
+        job->best_distance[chunk] = -1.0;
+        for (int p = first; p < last; p++) {
+            double r[4];
+            for (int k = 0; k < 4; k++) r[k] = point(job->hull, p)[k] - job->origin[k];
+            for (int b = 0; b < job->basis_count; b++) {
+                double along = dot4(r, job->basis[b]);
+                for (int k = 0; k < 4; k++) r[k] -= along * job->basis[b][k];
+            }
+            double d = dot4(r, r);
+            if (d > job->best_distance[chunk]) {
+                job->best_distance[chunk] = d;
+                job->best[chunk] = p;
+            }
+        }
+    }
+}
+
+// Five points spanning 4D as far apart as a few scans find them, 0 if they're all within a grid step of a plane
+static int find_simplex(Hull* hull, int* simplex) {
+    double origin[4], basis[4][4];
+    FarthestJob job = { hull, origin, (const double (*)[4])basis, 0, {0}, {0}, (hull->count + HULL_CHUNKS - 1) / HULL_CHUNKS };
+
+    // Furthest from the first point, then furthest from that one, then from each span in turn
+    for (int k = 0; k < 4; k++) origin[k] = point(hull, 0)[k];
+    for (int s = 0; s < 5; s++) {
+        pool_parallel_for(hull->pool, HULL_CHUNKS, 1, farthest_range, &job);
+        int best = -1;
+        double best_distance = -1.0;
+        for (int c = 0; c < HULL_CHUNKS; c++) {
+            if (job.best_distance[c] > best_distance) {
+                best_distance = job.best_distance[c];
+                best = job.best[c];
+            }
+        }
+        if (s > 0 && best_distance < 1.0) return 0;
+        simplex[s] = best;
+        if (s == 0) {
+            for (int k = 0; k < 4; k++) origin[k] = point(hull, best)[k];
+            continue;
+        }
+        double* axis = basis[job.basis_count];
+        for (int k = 0; k < 4; k++) axis[k] = point(hull, best)[k] - origin[k];
+        for (int b = 0; b < job.basis_count; b++) {
+            double along = dot4(axis, basis[b]);
+            for (int k = 0; k < 4; k++) axis[k] -= along * basis[b][k];
+        }
+        double length = sqrt(dot4(axis, axis));
+        for (int k = 0; k < 4; k++) axis[k] /= length;
+        job.basis_count++;
+    }
+    return 1;
+}
+
+// The simplex's five facets, each leaving out one vertex and neighbouring the facet that leaves out the other.
+// -1 if the simplex is flat after all, 0 if out of memory
+static int start_hull(Hull* hull, const int* simplex) {
+    hull->facet_count = 0;
+    hull->spare_count = 0;
+    hull->pending_count = 0;
+    for (int k = 0; k < 4; k++) {
+        hull->interior[k] = 0;
+        for (int s = 0; s < 5; s++) hull->interior[k] += point(hull, simplex[s])[k];
+    }
+    for (int s = 0; s < 5; s++) {
+        int f = new_facet(hull);
+        if (f < 0) return 0;
+        Facet* facet = &hull->facets[f];
+        for (int j = 0, m = 0; j < 5; j++) {
+            if (j == s) continue;
+            facet->v[m] = simplex[j];
+            facet->n[m] = j;
+            m++;
+        }
+        if (!plane_through(hull, facet->v, &facet->plane)) return -1;
+        facet->outside = -1;
+        facet->stamp = 0;
+        facet->alive = 1;
+    }
+    return 1;
+}
+
+// Quickhull: 1 done, -1 a horizon didn't pair up, 0 out of memory
+static int quickhull(Hull* hull, const int* simplex, HullStats* stats) {
+    double start = timer_now();
+    if (!reserve_moved(hull, hull->count)) return 0;
+    hull->moved_count = 0;
+    for (int p = 0; p < hull->count; p++) {
+        int corner = 0;
+        for (int s = 0; s < 5; s++) corner |= p == simplex[s];
+        if (!corner) hull->moved[hull->moved_count++] = p;
+    }
+    int first[5] = { 0, 1, 2, 3, 4 };
+    if (!assign_moved(hull, first, 5)) return 0;
+    stats->seconds[HULL_ASSIGN] = timer_now() - start;
+
+    start = timer_now();
+    while (hull->pending_count > 0) {
+        int f = hull->pending[--hull->pending_count];
+        const Facet* facet = &hull->facets[f];
+        if (!facet->alive || facet->outside < 0) continue;
+        int eye = facet->furthest;
+        if (!find_visible_from(hull, eye, f)) return 0;
+        int added = add_point(hull, eye);
+        if (added <= 0) return added;
+    }
+    stats->seconds[HULL_EXPAND] = timer_now() - start;
+    return 1;
+}
+
+// Beneath-beyond in input order. Points outside the hull that can't be added cleanly are left out and
+// counted in stats->skipped
+static int incremental(Hull* hull, const int* simplex, HullStats* stats) {
+    double start = timer_now();
+    for (int p = 0; p < hull->count; p++) {
+        int corner = 0, outside;
+        for (int s = 0; s < 5; s++) corner |= p == simplex[s];
+        if (corner) continue;
+        if (!find_visible_all(hull, p, &outside)) return 0;
+        int added = outside ? add_point(hull, p) : 1;
+        if (added == 0) return 0;
+        stats->skipped += added < 0;
+    }
+    stats->seconds[HULL_EXPAND] = timer_now() - start;
+    return 1;
+}
+
+static int find_root(int* parent, int f) {
+    while (parent[f] != f) f = parent[f] = parent[parent[f]];
+    return f;
+}
+
+static void add_cell(int* cells, int* count, int limit, int cell) {
+    for (int c = 0; c < *count; c++) {
+        if (cells[c] == cell) return;
+    }
+    if (*count < limit) cells[(*count)++] = cell;
+}
+
+// Facing the same way, with g's vertices on f's plane
+static int same_cell(const Hull* hull, const Facet* f, const Facet* g) {
+    if (hull->coplanar == 0.0) {
+        // Both face out of the hull, so sharing a plane is enough. Corners f has are on it already
+        for (int k = 0; k < 4; k++) {
+            int shared = g->v[k] == f->v[0] || g->v[k] == f->v[1] || g->v[k] == f->v[2] || g->v[k] == f->v[3];
+            if (!shared && wide_sign(side(hull, &f->plane, g->v[k])) != 0) return 0;
+        }
+        return 1;
+    }
+    if (1.0 - dot4(f->plane.unit, g->plane.unit) > HULL_ANGLE * HULL_ANGLE / 2.0) return 0;
+    for (int k = 0; k < 4; k++) {
+        if (fabs(distance(hull, &f->plane, g->v[k])) > hull->coplanar) return 0;
+    }
+    return 1;
+}
+
+// Rounding can leave a nearly flat facet over a ridge whose points were meant to be coplanar, like a
+// pentagon between two dodecahedra. It lies on a neighbour's plane but faces another way
+static int is_sliver(const Hull* hull, const Facet* f) {
+    if (hull->coplanar == 0.0) return 0;
+    for (int k = 0; k < 4; k++) {
+        const Facet* g = &hull->facets[f->n[k]];
+        if (fabs(distance(hull, &g->plane, f->v[k])) <= hull->coplanar && !same_cell(hull, g, f)) return 1;
+    }
+    return 0;
+}
+
+typedef struct {
+    const Hull* hull;
+    unsigned char* sliver;
+    unsigned char* merge;		// Bit k set when the neighbour across ridge k is in the same cell
+} MergeJob;
+
+// Pool task: slivers among a range of facets
+static void sliver_range(void* ctx, int start, int end) {
+    MergeJob* job = ctx;
+    for (int f = start; f < end; f++) {
+        const Facet* facet = &job->hull->facets[f];
+        job->sliver[f] = facet->alive && is_sliver(job->hull, facet);
+    }
+}
+
+// Pool task: which neighbours each facet in a range merges with, once every sliver is known
+static void merge_range(void* ctx, int start, int end) {
+    MergeJob* job = ctx;
+    for (int f = start; f < end; f++) {
+        const Facet* facet = &job->hull->facets[f];
+        job->merge[f] = 0;
+        if (!facet->alive || job->sliver[f]) continue;
+        for (int k = 0; k < 4; k++) {
+            if (!job->sliver[facet->n[k]] && same_cell(job->hull, facet, &job->hull->facets[facet->n[k]])) {
+                job->merge[f] |= 1 << k;
+            }
+        }
+    }
+}
+
+// A facet's corners and its cell, copied out together so the pass over the points finds them close by
+typedef struct {
+    int v[4];
+    int cell;
+} Corners;
+
+// Cells seen so far on the segment from a point to a higher one
+typedef struct {
+    int to;					// -1 for an empty slot
+    int cells[3];
+    int cell_count;
+} SegmentSlot;
+
+typedef struct {
+    const Hull* hull;
+    const Corners* corners;		// One per facet in a cell
+    const int* incident;		// Corners around point p from incident[incident_start[p]]
+    const int* incident_start;
+    unsigned char* vertex;		// Per point, in four cells or more
+    Edge* found[HULL_CHUNKS];	// Segments three cells share, from the lower end, per chunk of points
+    int found_count[HULL_CHUNKS];	// -1 if out of memory
+    int chunk_size;
+} SegmentJob;
+
+// Pool task: cells around each point of a chunk, and the segments up to higher points that three cells share
+static void segment_range(void* ctx, int start, int end) {
+    SegmentJob* job = ctx;
+    for (int chunk = start; chunk < end; chunk++) {
+        int first = chunk * job->chunk_size;
+        int last = first + job->chunk_size < job->hull->count ? first + job->chunk_size : job->hull->count;
+        SegmentSlot* table = NULL;
+        int table_capacity = 0, found_capacity = 0, ok = 1;
+        job->found[chunk] = NULL;
+        job->found_count[chunk] = 0;
+        for (int p = first; ok && p < last; p++) {
+            int from = job->incident_start[p], to = job->incident_start[p + 1];
+            // Each facet adds at most three segments, the table stays under half full
+            int size = 16;
+            while (size < (to - from) * 6) size <<= 1;
+            ok = reserve((void**)&table, &table_capacity, size, sizeof(SegmentSlot));
+            if (!ok) break;
+            for (int slot = 0; slot < size; slot++) table[slot].to = -1;
+
+            int cells[4], cell_count = 0;
+            for (int i = from; i < to; i++) {
+                const Corners* corners = &job->corners[job->incident[i]];
+                add_cell(cells, &cell_count, 4, corners->cell);
+                for (int k = 0; k < 4; k++) {
+                    int q = corners->v[k];
+                    if (q <= p) continue;
+                    size_t slot = ((uint64_t)q * 0x9e3779b97f4a7c15ULL >> 20) & (size - 1);
+                    while (table[slot].to >= 0 && table[slot].to != q) slot = (slot + 1) & (size - 1);
+                    if (table[slot].to < 0) {
+                        table[slot].to = q;
+                        table[slot].cell_count = 0;
+                    }
+                    add_cell(table[slot].cells, &table[slot].cell_count, 3, corners->cell);
+                }
+            }
+            job->vertex[p] = cell_count == 4;
+            for (int slot = 0; ok && slot < size; slot++) {
+                if (table[slot].to < 0 || table[slot].cell_count < 3) continue;
+                ok = reserve((void**)&job->found[chunk], &found_capacity, job->found_count[chunk] + 1, sizeof(Edge));
+                if (ok) job->found[chunk][job->found_count[chunk]++] = (Edge){ p, table[slot].to };
+            }
+        }
+        free(table);
+        if (!ok) job->found_count[chunk] = -1;
+    }
+}
+
+// Merge coplanar facets into cells, then follow the segments three cells share from vertex to vertex.
+// Ridges come from Euler's relation for 4-polytopes, vertices - edges + ridges - cells = 0.
+// The plane tests and the segments around each point run on the pool; joining cells and walking
+// edges are single passes over what they found, in facet and point order so any pool gives the same edges
+static int extract_faces(Hull* hull, Polyhedron* shape, HullStats* stats) {
+    int facet_count = hull->facet_count ? hull->facet_count : 1;
+    int* parent = malloc(sizeof(int) * facet_count);
+    Corners* corners = malloc(sizeof(Corners) * facet_count);
+    unsigned char* sliver = malloc(facet_count);
+    unsigned char* merge = malloc(facet_count);
+    int* incident_start = calloc((size_t)hull->count + 1, sizeof(int));
+    int* fill = malloc(sizeof(int) * (size_t)hull->count);
+    unsigned char* vertex = malloc(hull->count);
+    int* links = malloc(sizeof(int) * 2 * (size_t)hull->count);
+    int* incident = NULL;
+    Edge* edges = NULL;
+    SegmentJob job = { hull, corners, NULL, incident_start, vertex, {0}, {0}, (hull->count + HULL_CHUNKS - 1) / HULL_CHUNKS };
+    int edge_count = 0, edge_capacity = 0;
+    int ok = parent && corners && sliver && merge && incident_start && fill && vertex && links;
+
+    if (ok) {
+        MergeJob merge_job = { hull, sliver, merge };
+        int grain = (hull->facet_count + HULL_CHUNKS - 1) / HULL_CHUNKS;
+        if (hull->coplanar == 0.0) {
+            memset(sliver, 0, facet_count);
+        } else {
+            pool_parallel_for(hull->pool, hull->facet_count, grain, sliver_range, &merge_job);
+        }
+        pool_parallel_for(hull->pool, hull->facet_count, grain, merge_range, &merge_job);
+
+        for (int f = 0; f < hull->facet_count; f++) parent[f] = f;
+        for (int f = 0; f < hull->facet_count; f++) {
+            for (int k = 0; k < 4; k++) {
+                if (merge[f] & 1 << k) parent[find_root(parent, f)] = find_root(parent, hull->facets[f].n[k]);
+            }
+        }
+        // A sliver joins the first cell it lies on, which adds no segment three cells share
+        for (int f = 0; f < hull->facet_count; f++) {
+            const Facet* facet = &hull->facets[f];
+            for (int k = 0; sliver[f] && k < 4; k++) {
+                const Facet* g = &hull->facets[facet->n[k]];
+                if (!sliver[facet->n[k]] && fabs(distance(hull, &g->plane, facet->v[k])) <= hull->coplanar) {
+                    parent[f] = find_root(parent, facet->n[k]);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Each cell is named by its root facet, and each point lists the facets in a cell around it
+    int in_cells = 0;
+    for (int f = 0; ok && f < hull->facet_count; f++) {
+        const Facet* facet = &hull->facets[f];
+        int cell = find_root(parent, f);
+        stats->simplices += facet->alive;
+        if (!facet->alive || (cell == f && sliver[f])) continue;
+        stats->cells += cell == f;
+        memcpy(corners[in_cells].v, facet->v, sizeof(facet->v));
+        corners[in_cells++].cell = cell;
+        for (int k = 0; k < 4; k++) incident_start[facet->v[k] + 1]++;
+    }
+    if (ok) {
+        for (int p = 0; p < hull->count; p++) incident_start[p + 1] += incident_start[p];
+        memcpy(fill, incident_start, sizeof(int) * (size_t)hull->count);
+        incident = malloc(sizeof(int) * 4 * (size_t)(in_cells ? in_cells : 1));
+        ok = incident != NULL;
+    }
+    for (int c = 0; ok && c < in_cells; c++) {
+        for (int k = 0; k < 4; k++) incident[fill[corners[c].v[k]]++] = c;
+    }
+    if (ok) {
+        job.incident = incident;
+        pool_parallel_for(hull->pool, HULL_CHUNKS, 1, segment_range, &job);
+        for (int c = 0; c < HULL_CHUNKS; c++) ok &= job.found_count[c] >= 0;
+    }
+
+    // A point on an edge but not a vertex has exactly two edge segments, linked so a walk can pass it
+    if (ok) {
+        for (int p = 0; p < hull->count; p++) {
+            stats->vertices += vertex[p];
+            links[2 * p] = links[2 * p + 1] = -1;
+        }
+        for (int c = 0; c < HULL_CHUNKS; c++) {
+            for (int i = 0; i < job.found_count[c]; i++) {
+                int ends[2] = { job.found[c][i].start, job.found[c][i].end };
+                for (int e = 0; e < 2; e++) {
+                    int* link = &links[2 * ends[e]];
+                    link[link[0] < 0 ? 0 : 1] = ends[1 - e];
+                }
+            }
+        }
+    }
+    for (int c = 0; ok && c < HULL_CHUNKS; c++) {
+        for (int i = 0; ok && i < job.found_count[c]; i++) {
+            int ends[2] = { job.found[c][i].start, job.found[c][i].end };
+            for (int e = 0; e < 2 && ok; e++) {
+                int from = ends[e], previous = from, current = ends[1 - e];
+                if (!vertex[from]) continue;
+                for (int steps = 0; !vertex[current] && steps < hull->count; steps++) {
+                    const int* link = &links[2 * current];
+                    int next = link[0] == previous ? link[1] : link[0];
+                    if (next < 0) break;
+                    previous = current;
+                    current = next;
+                }
+                // Found from both ends, kept from the lower one
+                if (!vertex[current] || from > current) continue;
+                ok = reserve((void**)&edges, &edge_capacity, edge_count + 1, sizeof(Edge));
+                if (ok) edges[edge_count++] = (Edge){ from, current };
+            }
+        }
+    }
+
+    if (ok) {
+        free(shape->edges);
+        shape->edges = edges;
+        shape->e_count = edge_count;
+        stats->edges = edge_count;
+        stats->ridges = stats->cells + stats->edges - stats->vertices;
+    } else {
+        free(edges);
+    }
+    for (int c = 0; c < HULL_CHUNKS; c++) free(job.found[c]);
+    free(parent);
+    free(corners);
+    free(sliver);
+    free(merge);
+    free(incident_start);
+    free(fill);
+    free(vertex);
+    free(links);
+    free(incident);
+    return ok;
+}
+
+static void destroy(Hull* hull) {
+    free(hull->facets);
+    free(hull->spare);
+    free(hull->next);
+    free(hull->pending);
+    free(hull->visible);
+    free(hull->cones);
+    free(hull->ridges);
+    free(hull->moved);
+    free(hull->target);
+    free(hull->target_distance);
+    free((void*)hull->grid);
+}
+
+int hull_edges(Polyhedron* shape, WorkerPool* pool, double rounding, HullStats* stats) {
+    HullStats unused;
+    if (!stats) stats = &unused;
+    memset(stats, 0, sizeof(*stats));
+    if (shape->mapping || shape_dim(shape) != 4) {
+        fprintf(stderr, "Can't take the hull of %s, it has to be a 4D shape loaded from text\n", shape->name);
+        return 0;
+    }
+    if (shape->v_count < 5) {
+        fprintf(stderr, "%s needs at least 5 vertices for a 4D hull\n", shape->name);
+        return 0;
+    }
+
+    double start = timer_now();
+    Hull hull = {0};
+    hull.count = shape->v_count;
+    hull.pool = pool;
+    int32_t* grid = malloc(sizeof(int32_t) * 4 * (size_t)hull.count);
+    hull.grid = grid;
+    hull.next = malloc(sizeof(int) * (size_t)hull.count);
+    if (!grid || !hull.next) {
+        destroy(&hull);
+        fprintf(stderr, "Out of memory for the hull of %s\n", shape->name);
+        return 0;
+    }
+    double largest = 0.0;
+    for (int i = 0; i < hull.count; i++) {
+        Vertex v = shape_vertex(shape, i);
+        largest = fmax(largest, fmax(fmax(fabs(v.x), fabs(v.y)), fmax(fabs(v.z), fabs(v.w))));
+    }
+    double snap = largest > 0.0 ? (double)(1 << HULL_GRID_BITS) / largest : 1.0;
+    for (int i = 0; i < hull.count; i++) {
+        Vertex v = shape_vertex(shape, i);
+        int32_t* q = &grid[(size_t)i * 4];
+        q[0] = (int32_t)lround(v.x * snap);
+        q[1] = (int32_t)lround(v.y * snap);
+        q[2] = (int32_t)lround(v.z * snap);
+        q[3] = (int32_t)lround(v.w * snap);
+    }
+    hull.coplanar = rounding * (1 << HULL_GRID_BITS);
+
+    int simplex[5];
+    int result = find_simplex(&hull, simplex) ? start_hull(&hull, simplex) : -1;
+    stats->seconds[HULL_SIMPLEX] = timer_now() - start;
+    if (result < 0) {
+        destroy(&hull);
+        fprintf(stderr, "The vertices of %s don't span 4D, there is no 4D hull\n", shape->name);
+        return 0;
+    }
+
+    if (result > 0) result = quickhull(&hull, simplex, stats);
+    if (result < 0) {
+        stats->fallback = 1;
+        result = start_hull(&hull, simplex) > 0 ? incremental(&hull, simplex, stats) : 0;
+    }
+    start = timer_now();
+    if (result > 0) result = extract_faces(&hull, shape, stats);
+    stats->seconds[HULL_FACES] = timer_now() - start;
+    destroy(&hull);
+    if (result <= 0) {
+        fprintf(stderr, "Out of memory for the hull of %s\n", shape->name);
+        return 0;
+    }
+    return 1;
+}
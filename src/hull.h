@@ -0,0 +1,55 @@
+#ifndef HULL_H
+#define HULL_H
+
+#include "shapes.h"
+#include "pool.h"
+
+// 4D Convex Hull
+// Quickhull over tetrahedral facets: each facet keeps the points outside it, the furthest one is added
+// by replacing the facets it sees with a cone from the horizon. Point assignment and the cell merging's plane
+// tests and segment counts run on the pool; insertions stay in order, each changes the facets the next one sees.
+// Coordinates are snapped to a 2^28 integer grid so every side-of-plane test is exact (128-bit sums):
+// an insertion takes away the facets whose plane the point is on as well, which leaves no flat facet
+// behind however many points share a plane. If the horizon still doesn't pair every new ridge exactly
+// twice, the hull is rebuilt by plain incremental insertion that tests every facet. A point that can't be
+// added there either is left out and counted in skipped, so the hull may be missing it.
+// Coplanar facets are merged into the hull's real cells afterwards, so cubes don't get diagonals:
+// a vertex is a point in at least four cells and an edge runs between two vertices along segments three
+// cells share. By default only facets exactly on each other's plane merge, so points in general position
+// keep every edge. Polytopes written out as floats are only cohyperplanar to within rounding and need
+// HULL_ROUNDING for their cells to come out whole.
+
+#define HULL_GRID_BITS 28		// The largest coordinate becomes 2^28
+#define HULL_ROUNDING 3e-7		// Float polytopes: facets this close to each other's plane (relative to the largest coordinate)
+#define HULL_ANGLE 1e-4			// and this many radians apart are one cell
+#define HULL_PARALLEL_MIN 4096	// Points reassigned per step before the pool helps
+#define HULL_CHUNKS 64
+
+typedef enum {
+    HULL_SIMPLEX,			// Finding the starting simplex
+    HULL_ASSIGN,			// Giving every point to a facet it lies outside of
+    HULL_EXPAND,			// Adding points until no facet has any outside
+    HULL_FACES,				// Merging cells, counting ridges and edges
+    HULL_PHASES
+} HullPhase;
+
+typedef struct {
+    int vertices;			// Hull points in at least four cells, the rest lie on a cell, ridge or edge
+    int simplices;			// Tetrahedral facets
+    int cells;				// Facets once coplanar ones are merged
+    int ridges;				// Polygons between two cells
+    int edges;
+    int fallback;			// Built incrementally after quickhull failed
+    int skipped;			// Outside points the incremental build couldn't add, 0 unless the hull is wrong
+    double seconds[HULL_PHASES];
+} HullStats;
+
+extern const char* hull_phase_names[HULL_PHASES];
+
+// Replace the edges of a 4D shape with the edges of its vertices' convex hull, in parallel on pool
+// (NULL runs on the calling thread). Points inside or on a cell stay as unconnected vertices.
+// rounding is 0 for exact cells or a tolerance like HULL_ROUNDING. stats may be NULL.
+// 0 with a message on stderr if the points don't span 4D or memory runs out
+int hull_edges(Polyhedron* shape, WorkerPool* pool, double rounding, HullStats* stats);
+
+#endif
@@ -0,0 +1,69 @@
+#include "image.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define make_dir(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define make_dir(path) mkdir(path, 0755)
+#endif
+
+int image_write_ppm(const char* path, const unsigned char* rgba, int width, int height, int bottom_up) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s for writing\n", path);
+        return 0;
+    }
+
+    unsigned char* row = malloc((size_t)width * 3);
+    int ok = row != NULL && fprintf(file, "P6\n%d %d\n255\n", width, height) > 0;
+    for (int i = 0; ok && i < height; i++) {
+        const unsigned char* src = rgba + (size_t)(bottom_up ? height - 1 - i : i) * width * 4;
+        for (int x = 0; x < width; x++) {
+            row[x*3 + 0] = src[x*4 + 0];
+            row[x*3 + 1] = src[x*4 + 1];
+            row[x*3 + 2] = src[x*4 + 2];
+        }
+        ok = fwrite(row, 3, width, file) == (size_t)width;
+    }
+    free(row);
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Failed to write %s\n", path);
+    return ok;
+}
+
+unsigned char* image_read_ppm(const char* path, int* width, int* height) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return NULL;
+    }
+
+    // Only the P6 header image_write_ppm writes: no comments, a single whitespace before the pixels
+    int max_value;
+    unsigned char* rgb = NULL;
+    if (fscanf(file, "P6 %d %d %d", width, height, &max_value) == 3 && max_value == 255 && fgetc(file) != EOF &&
+        *width > 0 && *height > 0) {
+        size_t size = (size_t)*width * *height * 3;
+        rgb = malloc(size);
+        if (rgb && fread(rgb, 1, size, file) != size) {
+            free(rgb);
+            rgb = NULL;
+        }
+    }
+    fclose(file);
+    if (!rgb) fprintf(stderr, "Failed to read %s\n", path);
+    return rgb;
+}
+
+int image_make_dir(const char* dir) {
+    if (make_dir(dir) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Failed to create %s: %s\n", dir, strerror(errno));
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,12 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+// Writes 8-bit RGBA pixels as a binary PPM (alpha dropped), rows bottom up when bottom_up is set
+// as glReadPixels returns them. 0 on failure
+int image_write_ppm(const char* path, const unsigned char* rgba, int width, int height, int bottom_up);
+// Reads a binary PPM as written above into a malloc'd RGB buffer, rows top down. NULL on failure
+unsigned char* image_read_ppm(const char* path, int* width, int* height);
+// Creates dir unless it already exists, 0 on failure
+int image_make_dir(const char* dir);
+
+#endif
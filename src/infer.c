@@ -0,0 +1,327 @@
+#include "infer.h"
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Occupied grid cell, a hash table slot. The key packs the cell coordinates so it is exact
+typedef struct {
+    uint64_t key;
+    int start, count;		// Range of order, count 0 for an empty slot
+} GridCell;
+
+typedef struct {
+    const float* points;	// dim floats every stride floats
+    int stride, dim, v_count;
+    int axes[INFER_GRID_AXES], axis_count;
+    float origin[INFER_GRID_AXES];
+    float inv_cell;
+    int bits;				// Per axis in the key
+    int limit;				// Cell coordinates are below this
+    int* order;				// Vertices grouped by cell, ascending within a cell
+    GridCell* cells;
+    uint64_t mask;			// Table size - 1, a power of two
+    int* occupied;			// Slots in use, in order of their first vertex
+    int occupied_count;
+} Grid;
+
+typedef struct {
+    int a, b;
+    float distance2;
+} Candidate;
+
+// Pairs one chunk of cells found
+typedef struct {
+    Candidate* pairs;
+    int count, capacity;
+    float nearest;
+    int failed;
+} CandidateList;
+
+typedef struct {
+    Grid* grid;
+    float min_distance2;	// Pairs closer than this are coincident
+    float max_distance2;	// Pairs further apart are never edges
+    int chunk_size;			// Cells per chunk
+    CandidateList* lists;
+    const int* samples;
+    float* sample_nearest;
+} InferJob;
+
+static inline const float* point(const Grid* grid, int i) {
+    return grid->points + (size_t)i * grid->stride;
+}
+
+static inline float distance2(const Grid* grid, int a, int b) {
+    const float* p = point(grid, a);
+    const float* q = point(grid, b);
+    float sum = 0.0f;
+    for (int k = 0; k < grid->dim; k++) {
+        float d = p[k] - q[k];
+        sum += d * d;
+    }
+    return sum;
+}
+
+static inline uint64_t pack_key(const Grid* grid, const int* c) {
+    uint64_t key = 0;
+    for (int a = 0; a < grid->axis_count; a++) key |= (uint64_t)c[a] << (grid->bits * a);
+    return key;
+}
+
+// Neighbours along the first axis land in neighbouring slots, so searching cells in the order
+// the file lists them (usually spatially coherent) keeps the table lookups in cache
+static inline uint64_t slot_of(const Grid* grid, const int* c) {
+    static const uint64_t primes[INFER_GRID_AXES] = { 1, 73856093, 19349663, 83492791 };
+    uint64_t slot = 0;
+    for (int a = 0; a < grid->axis_count; a++) slot += (uint64_t)c[a] * primes[a];
+    return slot & grid->mask;
+}
+
+static GridCell* find_cell(const Grid* grid, const int* c) {
+    uint64_t key = pack_key(grid, c);
+    for (uint64_t slot = slot_of(grid, c); ; slot = (slot + 1) & grid->mask) {
+        GridCell* cell = &grid->cells[slot];
+        if (cell->count == 0 || cell->key == key) return cell;
+    }
+}
+
+static void vertex_cell(const Grid* grid, int i, int* c) {
+    for (int a = 0; a < grid->axis_count; a++) {
+        c[a] = (int)((point(grid, i)[grid->axes[a]] - grid->origin[a]) * grid->inv_cell);
+        if (c[a] >= grid->limit) c[a] = grid->limit - 1;
+    }
+}
+
+static void grid_destroy(Grid* grid) {
+    free(grid->order);
+    free(grid->cells);
+    free(grid->occupied);
+}
+
+// Bucket every vertex by cell, counting sort through the hash table so this stays linear.
+// Cells grow if the extent doesn't fit the key, that only costs more comparisons
+static int grid_build(Grid* grid, float cell_size, float extent) {
+    int n = grid->v_count;
+    grid->bits = grid->axis_count > 1 ? 64 / grid->axis_count : 31;
+    if (grid->bits > 31) grid->bits = 31;
+    grid->limit = 1 << grid->bits;
+    if (extent / cell_size > grid->limit - 2) cell_size = extent / (grid->limit - 2);
+    grid->inv_cell = 1.0f / cell_size;
+
+    uint64_t size = 1;
+    while (size < (uint64_t)n * 2) size <<= 1;
+    grid->mask = size - 1;
+    grid->order = malloc(sizeof(int) * (size_t)n);
+    grid->cells = calloc(size, sizeof(GridCell));
+    grid->occupied = malloc(sizeof(int) * (size_t)n);
+    if (!grid->order || !grid->cells || !grid->occupied) return 0;
+
+    int c[INFER_GRID_AXES];
+    for (int i = 0; i < n; i++) {
+        vertex_cell(grid, i, c);
+        GridCell* cell = find_cell(grid, c);
+        if (cell->count++ == 0) {
+            cell->key = pack_key(grid, c);
+            grid->occupied[grid->occupied_count++] = (int)(cell - grid->cells);
+        }
+    }
+    int start = 0;
+    for (int o = 0; o < grid->occupied_count; o++) {
+        GridCell* cell = &grid->cells[grid->occupied[o]];
+        cell->start = start;
+        start += cell->count;
+        cell->count = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        vertex_cell(grid, i, c);
+        GridCell* cell = find_cell(grid, c);
+        grid->order[cell->start + cell->count++] = i;
+    }
+    return 1;
+}
+
+static void add_candidate(CandidateList* list, int a, int b, float d2) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 1024;
+        Candidate* pairs = realloc(list->pairs, sizeof(Candidate) * capacity);
+        if (!pairs) {
+            list->failed = 1;
+            return;
+        }
+        list->pairs = pairs;
+        list->capacity = capacity;
+    }
+    list->pairs[list->count++] = (Candidate){ a, b, d2 };
+    if (d2 < list->nearest) list->nearest = d2;
+}
+
+// Pool task: pairs within max_distance2 between each cell and the half of its neighbours
+// after it (plus itself), so every pair of neighbouring cells is searched exactly once
+static void search_range(void* ctx, int start, int end) {
+    InferJob* job = ctx;
+    const Grid* grid = job->grid;
+    int axes = grid->axis_count;
+    for (int chunk = start; chunk < end; chunk++) {
+        CandidateList* list = &job->lists[chunk];
+        int first = chunk * job->chunk_size;
+        int last = first + job->chunk_size < grid->occupied_count ? first + job->chunk_size : grid->occupied_count;
+        for (int o = first; o < last && !list->failed; o++) {
+            const GridCell* cell = &grid->cells[grid->occupied[o]];
+            int own[INFER_GRID_AXES], offset[INFER_GRID_AXES];
+            for (int a = 0; a < axes; a++) {
+                own[a] = (int)((cell->key >> (grid->bits * a)) & ((1ULL << grid->bits) - 1));
+                offset[a] = -1;
+            }
+            for (;;) {
+                // Lexicographically positive offsets only
+                int sign = 0, inside = 1, around[INFER_GRID_AXES];
+                for (int a = axes - 1; a >= 0; a--) {
+                    if (sign == 0) sign = offset[a];
+                    around[a] = own[a] + offset[a];
+                    if (around[a] < 0 || around[a] >= grid->limit) inside = 0;
+                }
+                if (sign >= 0 && inside) {
+                    const GridCell* other = sign == 0 ? cell : find_cell(grid, around);
+                    for (int p = cell->start; p < cell->start + cell->count; p++) {
+                        int i = grid->order[p];
+                        for (int q = sign == 0 ? p + 1 : other->start; q < other->start + other->count; q++) {
+                            int j = grid->order[q];
+                            float d2 = distance2(grid, i, j);
+                            if (d2 > job->min_distance2 && d2 <= job->max_distance2) {
+                                add_candidate(list, i < j ? i : j, i < j ? j : i, d2);
+                            }
+                        }
+                    }
+                }
+                int a = 0;
+                while (a < axes && ++offset[a] == 2) offset[a++] = -1;
+                if (a == axes) break;
+            }
+        }
+    }
+}
+
+// Pool task: nearest distinct vertex to each sample, brute force
+static void sample_range(void* ctx, int start, int end) {
+    InferJob* job = ctx;
+    const Grid* grid = job->grid;
+    for (int s = start; s < end; s++) {
+        int i = job->samples[s];
+        float nearest = FLT_MAX;
+        for (int j = 0; j < grid->v_count; j++) {
+            float d2 = distance2(grid, i, j);
+            if (d2 > job->min_distance2 && d2 < nearest) nearest = d2;
+        }
+        job->sample_nearest[s] = nearest;
+    }
+}
+
+int infer_edges(Polyhedron* shape, WorkerPool* pool, float* edge_length) {
+    if (shape->mapping || (!shape->vertices && !shape->coords)) {
+        fprintf(stderr, "Can't infer edges of %s, it has to be loaded from text and not converted to SoA\n", shape->name);
+        return 0;
+    }
+
+    Grid grid = {0};
+    grid.points = shape->coords ? shape->coords : (const float*)shape->vertices;
+    grid.dim = shape_dim(shape);
+    grid.stride = shape->coords ? grid.dim : 4;
+    grid.v_count = shape->v_count;
+    int n = shape->v_count;
+
+    // The widest axes make the grid, the others are only compared
+    float low[POLY_MAX_DIM], high[POLY_MAX_DIM], extent = 0.0f;
+    for (int k = 0; k < grid.dim; k++) {
+        low[k] = FLT_MAX;
+        high[k] = -FLT_MAX;
+    }
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < grid.dim; k++) {
+            float c = point(&grid, i)[k];
+            low[k] = c < low[k] ? c : low[k];
+            high[k] = c > high[k] ? c : high[k];
+        }
+    }
+    int used[POLY_MAX_DIM] = {0};
+    grid.axis_count = grid.dim < INFER_GRID_AXES ? grid.dim : INFER_GRID_AXES;
+    for (int a = 0; a < grid.axis_count; a++) {
+        int widest = -1;
+        for (int k = 0; k < grid.dim; k++) {
+            if (!used[k] && (widest < 0 || high[k] - low[k] > high[widest] - low[widest])) widest = k;
+        }
+        used[widest] = 1;
+        grid.axes[a] = widest;
+        grid.origin[a] = low[widest];
+        if (high[widest] - low[widest] > extent) extent = high[widest] - low[widest];
+    }
+
+    int samples[INFER_SAMPLES];
+    float sample_nearest[INFER_SAMPLES];
+    CandidateList lists[INFER_CHUNKS];
+    memset(lists, 0, sizeof(lists));
+    float coincident = extent * 1e-6f;
+    InferJob job = { &grid, coincident * coincident, 0.0f, 0, lists, samples, sample_nearest };
+
+    // Any sample's nearest neighbour is at least the minimum distance, the closest one makes the cells
+    int sample_count = n < INFER_SAMPLES ? n : INFER_SAMPLES;
+    for (int s = 0; s < sample_count; s++) samples[s] = (int)((long long)s * n / sample_count);
+    pool_parallel_for(pool, sample_count, 1, sample_range, &job);
+    float cell = FLT_MAX;
+    for (int s = 0; s < sample_count; s++) cell = sample_nearest[s] < cell ? sample_nearest[s] : cell;
+
+    Edge* edges = NULL;
+    size_t total = 0;
+    float nearest = FLT_MAX;
+    int ok = 1;
+    if (cell < FLT_MAX) {
+        // Past the tolerance so every edge of the shortest length stays within neighbouring cells
+        cell = sqrtf(cell) * (1.0f + INFER_TOLERANCE);
+        ok = grid_build(&grid, cell, extent);
+        if (ok) {
+            job.max_distance2 = cell * cell;
+            job.chunk_size = (grid.occupied_count + INFER_CHUNKS - 1) / INFER_CHUNKS;
+            for (int c = 0; c < INFER_CHUNKS; c++) lists[c].nearest = FLT_MAX;
+            pool_parallel_for(pool, INFER_CHUNKS, 1, search_range, &job);
+            for (int c = 0; c < INFER_CHUNKS; c++) {
+                ok &= !lists[c].failed;
+                nearest = lists[c].nearest < nearest ? lists[c].nearest : nearest;
+            }
+        }
+
+        // Keep the candidates near the minimum, in chunk order so any thread count gives the same edges
+        float longest2 = 0.0f;
+        if (ok) {
+            nearest = sqrtf(nearest);
+            longest2 = nearest * (1.0f + INFER_TOLERANCE) * nearest * (1.0f + INFER_TOLERANCE);
+            for (int c = 0; c < INFER_CHUNKS; c++) {
+                for (int p = 0; p < lists[c].count; p++) total += lists[c].pairs[p].distance2 <= longest2;
+            }
+            ok = total <= INT_MAX && (edges = malloc(sizeof(Edge) * (total ? total : 1))) != NULL;
+        }
+        if (ok) {
+            size_t e = 0;
+            for (int c = 0; c < INFER_CHUNKS; c++) {
+                for (int p = 0; p < lists[c].count; p++) {
+                    const Candidate* pair = &lists[c].pairs[p];
+                    if (pair->distance2 <= longest2) edges[e++] = (Edge){ pair->a, pair->b };
+                }
+            }
+        }
+        for (int c = 0; c < INFER_CHUNKS; c++) free(lists[c].pairs);
+    }
+    grid_destroy(&grid);
+    if (!ok) {
+        fprintf(stderr, "Out of memory inferring the edges of %s\n", shape->name);
+        return 0;
+    }
+
+    free(shape->edges);
+    shape->edges = edges;
+    shape->e_count = (int)total;
+    if (edge_length) *edge_length = nearest < FLT_MAX ? nearest : 0.0f;
+    return 1;
+}
@@ -0,0 +1,26 @@
+#ifndef INFER_H
+#define INFER_H
+
+#include "shapes.h"
+#include "pool.h"
+
+// Edge Inference
+// Gives shapes specified by their vertices only (regular polytopes, lattices) the edges between every
+// pair of vertices at the minimum distance, allowing INFER_TOLERANCE of it for rounding in the file.
+// Vertices are hashed into a uniform grid over the INFER_GRID_AXES widest axes with cells as wide as
+// an edge can be, so each vertex is only compared against the vertices in its neighbouring cells,
+// and each pair of neighbouring cells is searched once. That makes it linear in the vertices for
+// lattices and polytopes. The cell size comes from the nearest neighbours of INFER_SAMPLES vertices.
+
+#define INFER_TOLERANCE 1e-3f
+#define INFER_GRID_AXES 4
+#define INFER_SAMPLES 64
+// Slices of the grid cells searched in parallel, like the rasterizer's bin chunks
+#define INFER_CHUNKS 64
+
+// Replace the edges of shape with the inferred ones, in parallel on pool (NULL runs on the calling thread).
+// Coincident vertices are ignored. edge_length gets the minimum distance and may be NULL.
+// Not for shapes mapped from a .shapeb or converted to SoA. 0 with a message on stderr on failure
+int infer_edges(Polyhedron* shape, WorkerPool* pool, float* edge_length);
+
+#endif
@@ -0,0 +1,48 @@
+#include "input.h"
+#include <string.h>
+
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    (void)scancode;
+    InputQueue* input = glfwGetWindowUserPointer(window);
+    if (key < 0 || key > GLFW_KEY_LAST) return;		// GLFW_KEY_UNKNOWN
+    if (action != GLFW_REPEAT) input->held[key] = action == GLFW_PRESS;
+
+    // A full queue means nobody is reading, the newest events are the ones to lose
+    if (input->count == INPUT_QUEUE_SIZE) return;
+    input->events[(input->head + input->count) % INPUT_QUEUE_SIZE] = (KeyEvent){ key, action, mods };
+    input->count++;
+}
+
+static void size_callback(GLFWwindow* window, int width, int height) {
+    InputQueue* input = glfwGetWindowUserPointer(window);
+    input->width = width;
+    input->height = height;
+    input->damaged = 1;
+}
+
+static void refresh_callback(GLFWwindow* window) {
+    InputQueue* input = glfwGetWindowUserPointer(window);
+    input->damaged = 1;
+}
+
+void input_attach(InputQueue* input, GLFWwindow* window) {
+    memset(input, 0, sizeof(*input));
+    glfwGetFramebufferSize(window, &input->width, &input->height);
+    input->damaged = 1;
+    glfwSetWindowUserPointer(window, input);
+    glfwSetKeyCallback(window, key_callback);
+    glfwSetFramebufferSizeCallback(window, size_callback);
+    glfwSetWindowRefreshCallback(window, refresh_callback);
+}
+
+int input_next(InputQueue* input, KeyEvent* event) {
+    if (input->count == 0) return 0;
+    *event = input->events[input->head];
+    input->head = (input->head + 1) % INPUT_QUEUE_SIZE;
+    input->count--;
+    return 1;
+}
+
+int input_held(const InputQueue* input, int key) {
+    return key >= 0 && key <= GLFW_KEY_LAST && input->held[key];
+}
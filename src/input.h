@@ -0,0 +1,32 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <GLFW/glfw3.h>
+
+// Keyboard Input
+// GLFW's key callback queues every key event and tracks which keys are held, so the main loop
+// handles each press exactly once per frame instead of polling and spinning until the key is released.
+// Window callbacks record size changes and exposes, which need a redraw even when nothing moved.
+
+#define INPUT_QUEUE_SIZE 64
+
+typedef struct {
+    int key, action, mods;
+} KeyEvent;
+
+typedef struct {
+    KeyEvent events[INPUT_QUEUE_SIZE];
+    int head, count;		// Ring of pending events
+    unsigned char held[GLFW_KEY_LAST + 1];
+    int width, height;		// Framebuffer size
+    int damaged;			// Resized or exposed since the caller last cleared it
+} InputQueue;
+
+// Install the key and window callbacks on window, which then feed input
+void input_attach(InputQueue* input, GLFWwindow* window);
+// Oldest pending event, 0 when there are none left
+int input_next(InputQueue* input, KeyEvent* event);
+// Whether key is down as of the last glfwPollEvents
+int input_held(const InputQueue* input, int key);
+
+#endif
@@ -0,0 +1,330 @@
+#include "library.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "timer.h"
+#include "generators.h"
+#include "infer.h"
+#include "hull.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+// Alphanumerical Sort
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(const char **)a, *(const char**)b);
+}
+
+// Sorted .shape/.shapeb file names in dirpath
+static char** list_shape_files(const char* dirpath, int* file_count) {
+    char** files = NULL;
+    *file_count = 0;
+
+    #ifdef _WIN32
+    // WINDOWS BASED SYSTEMS USE THIS
+    WIN32_FIND_DATAA findData;
+    char searchPath[256];
+    snprintf(searchPath, sizeof(searchPath), "%s\\*.shape*", dirpath);
+
+    HANDLE hFind = FindFirstFileA(searchPath, &findData);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "Failed to open directory: %s\n", dirpath);
+        return NULL;
+    }
+
+    do {
+        files = realloc(files, sizeof(char*) * (*file_count + 1));
+        files[*file_count] = _strdup(findData.cFileName);
+        (*file_count)++;
+    } while (FindNextFileA(hFind, &findData));
+
+    FindClose(hFind);
+    #else
+    // POSIX COMPLIANT SYSTEMS USE THIS
+    DIR *dir;
+    if((dir = opendir(dirpath)) == NULL) {
+        fprintf(stderr, "Failed to open directory: %s\n", dirpath);
+        return NULL;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strstr(ent->d_name, ".shape")) {
+            files = realloc(files, sizeof(char*) * (*file_count + 1));
+            files[*file_count] = strdup(ent->d_name);
+            (*file_count)++;
+        }
+    }
+    closedir(dir);
+    #endif
+
+    if (*file_count > 0) qsort(files, *file_count, sizeof(char*), compare_names);
+    return files;
+}
+
+// Full load in whatever layout the library was opened with. pool helps with edge inference and hulls,
+// NULL from inside a pool task
+static int load_entry_shape(const ShapeEntry* entry, int flags, WorkerPool* pool, Polyhedron* shape) {
+    if (!load_shape(entry->path, shape)) return 0;
+    if (shape->e_count == 0 && shape->v_count > 1) {
+        float length;
+        HullStats hull;
+        if ((flags & LIBRARY_HULL) && shape_dim(shape) == 4) {
+            if (!hull_edges(shape, pool, (flags & LIBRARY_HULL_ROUNDED) ? HULL_ROUNDING : 0.0, &hull)) {
+                free_shape(shape);
+                return 0;
+            }
+            if (hull.skipped) {
+                fprintf(stderr, "Hull of %s left out %d outside points it couldn't add, it may be missing vertices\n",
+                        entry->file, hull.skipped);
+            }
+            if (flags & LIBRARY_VERBOSE) {
+                fprintf(stdout, "Hull of %s: %d vertices, %d edges, %d ridges, %d cells (", entry->file,
+                        hull.vertices, hull.edges, hull.ridges, hull.cells);
+                for (int phase = 0; phase < HULL_PHASES; phase++) {
+                    fprintf(stdout, "%s%s %.1f ms", phase ? ", " : "", hull_phase_names[phase], hull.seconds[phase] * 1000.0);
+                }
+                fprintf(stdout, "%s)\n", hull.fallback ? ", incremental" : "");
+            }
+        } else if (!(flags & LIBRARY_INFER)) {
+            fprintf(stderr, "%s has no edges, --infer-edges connects its nearest vertices, --hull draws a 4D shape's hull\n", entry->file);
+        } else if (!infer_edges(shape, pool, &length)) {
+            free_shape(shape);
+            return 0;
+        } else if (flags & LIBRARY_VERBOSE) {
+            fprintf(stdout, "Inferred %d edges of length %g for %s\n", shape->e_count, length, entry->file);
+        }
+    }
+    if ((flags & LIBRARY_SOA) && !shape_to_soa(shape)) {
+        free_shape(shape);
+        return 0;
+    }
+    return 1;
+}
+
+typedef struct {
+    ShapeEntry* entry;
+    int flags;
+    WorkerPool* pool;	// Only when the task runs on the calling thread
+} ScanTask;
+
+// Pool task: full load (eager) or header scan (lazy)
+static void scan_task(void* arg) {
+    ScanTask* task = arg;
+    ShapeEntry* entry = task->entry;
+    double start = timer_now();
+    if (entry->state == ENTRY_LOADING) {
+        entry->state = load_entry_shape(entry, task->flags, task->pool, &entry->shape) ? ENTRY_LOADED : ENTRY_FAILED;
+    } else {
+        entry->state = load_shape_header(entry->path, &entry->shape) ? ENTRY_UNLOADED : ENTRY_FAILED;
+    }
+    entry->load_seconds = timer_now() - start;
+}
+
+int library_open(ShapeLibrary* lib, const char* dirpath, int flags) {
+    int lazy = flags & LIBRARY_LAZY;
+    int verbose = flags & LIBRARY_VERBOSE;
+    memset(lib, 0, sizeof(*lib));
+    lib->flags = flags;
+    pthread_mutex_init(&lib->lock, NULL);
+    pthread_cond_init(&lib->state_changed, NULL);
+    if (!dirpath) {
+        lib->pool = pool_create(0);
+        return 1;
+    }
+
+    int file_count;
+    char** files = list_shape_files(dirpath, &file_count);
+    if (file_count == 0) {
+        fprintf(stderr, "No shapes found in %s\n", dirpath);
+        free(files);
+        return 0;
+    }
+
+    // One pool task per file straight into its sorted slot
+    lib->entries = calloc(file_count, sizeof(ShapeEntry));
+    ScanTask* tasks = calloc(file_count, sizeof(ScanTask));
+    lib->pool = pool_create(0);
+    double load_start = timer_now();
+    int submitted = 0;
+    for(int i = 0; i < file_count; i++) {
+        // A converted "name.shapeb" sorts right after "name.shape", prefer the binary one
+        if (i + 1 < file_count && strncmp(files[i], files[i+1], strlen(files[i])) == 0
+            && strcmp(files[i+1] + strlen(files[i]), "b") == 0) {
+            continue;
+        }
+        ShapeEntry* entry = &lib->entries[submitted++];
+        snprintf(entry->file, sizeof(entry->file), "%s", files[i]);
+        snprintf(entry->path, sizeof(entry->path), "%s/%s", dirpath, files[i]);
+        entry->state = lazy ? ENTRY_UNLOADED : ENTRY_LOADING;
+        tasks[i] = (ScanTask){ entry, flags, NULL };
+        // A single shape has the whole pool to itself
+        if (lib->pool && file_count > 1) {
+            pool_submit(lib->pool, scan_task, &tasks[i]);
+        } else {
+            tasks[i].pool = lib->pool;
+            scan_task(&tasks[i]);
+        }
+    }
+    if (lib->pool) pool_wait(lib->pool);
+    free(tasks);
+
+    // Compact usable entries, keeping alphanumerical order
+    for(int i = 0; i < submitted; i++) {
+        ShapeEntry* entry = &lib->entries[i];
+        if (entry->state == ENTRY_FAILED) {
+            fprintf(stderr, "Shape \"%s\" failed to intialize\n", entry->path);
+            continue;
+        }
+        if (verbose) {
+            fprintf(stdout, "%s %-32s %8d vertices %8d edges %9.2f ms\n", lazy ? "Scanned" : "Loaded",
+                    entry->file, entry->shape.v_count, entry->shape.e_count, entry->load_seconds * 1000.0);
+        }
+        lib->entries[lib->count++] = *entry;
+    }
+    if (verbose) {
+        fprintf(stdout, "%s %d shapes in %.2f ms on %d threads\n", lazy ? "Scanned" : "Loaded", lib->count,
+                (timer_now() - load_start) * 1000.0, lib->pool ? pool_thread_count(lib->pool) : 1);
+    }
+
+    for(int i = 0; i < file_count; i++) free(files[i]);
+    free(files);
+
+    if (lib->count == 0) {
+        fprintf(stderr, "No shapes could be loaded from %s\n", dirpath);
+        return 0;
+    }
+    return 1;
+}
+
+int library_generate(ShapeLibrary* lib, const char* spec) {
+    double start = timer_now();
+    Polyhedron shape;
+    if (!generate_shape(spec, &shape)) return 0;
+    if ((lib->flags & LIBRARY_SOA) && !shape_to_soa(&shape)) {
+        fprintf(stderr, "Out of memory converting %s\n", shape.name);
+        free_shape(&shape);
+        return 0;
+    }
+
+    ShapeEntry* entries = realloc(lib->entries, sizeof(ShapeEntry) * (lib->count + 1));
+    if (!entries) {
+        free_shape(&shape);
+        return 0;
+    }
+    lib->entries = entries;
+    ShapeEntry* entry = &lib->entries[lib->count++];
+    memset(entry, 0, sizeof(*entry));
+    snprintf(entry->file, sizeof(entry->file), "%s", spec);
+    entry->shape = shape;
+    entry->state = ENTRY_LOADED;
+    entry->generated = 1;
+    entry->load_seconds = timer_now() - start;
+    if (lib->flags & LIBRARY_VERBOSE) {
+        fprintf(stdout, "Generated %-29s %8d vertices %8d edges %9.2f ms\n", spec, shape.v_count, shape.e_count,
+                entry->load_seconds * 1000.0);
+    }
+    return 1;
+}
+
+void library_close(ShapeLibrary* lib) {
+    // Let outstanding prefetches finish before their entries go away
+    pool_destroy(lib->pool);
+    for (int i = 0; i < lib->count; i++) {
+        if (lib->entries[i].state == ENTRY_LOADED) free_shape(&lib->entries[i].shape);
+    }
+    free(lib->entries);
+    pthread_mutex_destroy(&lib->lock);
+    pthread_cond_destroy(&lib->state_changed);
+    memset(lib, 0, sizeof(*lib));
+}
+
+// Load entry on the calling thread, the caller has already moved it to ENTRY_LOADING
+static void load_entry(ShapeLibrary* lib, ShapeEntry* entry, WorkerPool* pool) {
+    Polyhedron shape;
+    double start = timer_now();
+    int ok = load_entry_shape(entry, lib->flags, pool, &shape);
+    double elapsed = timer_now() - start;
+
+    pthread_mutex_lock(&lib->lock);
+    if (ok) {
+        entry->shape = shape;
+        entry->state = ENTRY_LOADED;
+    } else {
+        entry->state = ENTRY_FAILED;
+    }
+    entry->load_seconds = elapsed;
+    pthread_cond_broadcast(&lib->state_changed);
+    pthread_mutex_unlock(&lib->lock);
+
+    if (!ok) fprintf(stderr, "Shape \"%s\" failed to intialize\n", entry->path);
+    else if (lib->flags & LIBRARY_VERBOSE) fprintf(stdout, "Loaded %-32s %9.2f ms\n", entry->file, elapsed * 1000.0);
+}
+
+typedef struct {
+    ShapeLibrary* lib;
+    ShapeEntry* entry;
+} PrefetchTask;
+
+static void prefetch_task(void* arg) {
+    PrefetchTask* task = arg;
+    load_entry(task->lib, task->entry, NULL);
+    free(task);
+}
+
+Polyhedron* library_get(ShapeLibrary* lib, int idx) {
+    ShapeEntry* entry = &lib->entries[idx];
+    pthread_mutex_lock(&lib->lock);
+    while (entry->state == ENTRY_LOADING) pthread_cond_wait(&lib->state_changed, &lib->lock);
+    if (entry->state == ENTRY_UNLOADED) {
+        entry->state = ENTRY_LOADING;
+        pthread_mutex_unlock(&lib->lock);
+        load_entry(lib, entry, lib->pool);
+        pthread_mutex_lock(&lib->lock);
+    }
+    Polyhedron* shape = entry->state == ENTRY_LOADED ? &entry->shape : NULL;
+    pthread_mutex_unlock(&lib->lock);
+    return shape;
+}
+
+void library_prefetch(ShapeLibrary* lib, int idx) {
+    ShapeEntry* entry = &lib->entries[idx];
+    pthread_mutex_lock(&lib->lock);
+    if (entry->state != ENTRY_UNLOADED || !lib->pool) {
+        pthread_mutex_unlock(&lib->lock);
+        return;
+    }
+    entry->state = ENTRY_LOADING;
+    pthread_mutex_unlock(&lib->lock);
+
+    PrefetchTask* task = malloc(sizeof(PrefetchTask));
+    if (!task) {
+        pthread_mutex_lock(&lib->lock);
+        entry->state = ENTRY_UNLOADED;
+        pthread_mutex_unlock(&lib->lock);
+        return;
+    }
+    task->lib = lib;
+    task->entry = entry;
+    pool_submit(lib->pool, prefetch_task, task);
+}
+
+void library_unload(ShapeLibrary* lib, int idx) {
+    ShapeEntry* entry = &lib->entries[idx];
+    pthread_mutex_lock(&lib->lock);
+    if (entry->state == ENTRY_LOADED && !entry->generated) {
+        free_shape(&entry->shape);
+        entry->state = ENTRY_UNLOADED;
+    }
+    pthread_mutex_unlock(&lib->lock);
+}
+
+int library_is_loaded(ShapeLibrary* lib, int idx) {
+    pthread_mutex_lock(&lib->lock);
+    int loaded = lib->entries[idx].state == ENTRY_LOADED;
+    pthread_mutex_unlock(&lib->lock);
+    return loaded;
+}
@@ -0,0 +1,60 @@
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include "threads.h"
+#include "shapes.h"
+#include "pool.h"
+
+// Shape Library
+// The sorted set of shapes found in a directory. Eager libraries load everything up front,
+// lazy ones only read headers and load each shape the first time it is asked for.
+
+typedef enum {
+    ENTRY_UNLOADED,		// Header only
+    ENTRY_LOADING,		// Being loaded on some thread
+    ENTRY_LOADED,
+    ENTRY_FAILED
+} EntryState;
+
+typedef struct {
+    char file[256];
+    char path[512];
+    Polyhedron shape;	// Name and counts always valid, vertices/edges only when loaded
+    EntryState state;
+    double load_seconds;
+    int generated;		// Built in memory, stays loaded since there is no file to reload it from
+} ShapeEntry;
+
+// library_open flags
+#define LIBRARY_LAZY    1	// Headers only until a shape is asked for
+#define LIBRARY_VERBOSE 2	// Report load times
+#define LIBRARY_SOA     4	// Convert vertices to structure-of-arrays after loading
+#define LIBRARY_INFER   8	// Infer the edges of vertex-only shapes after loading (see infer.h)
+#define LIBRARY_HULL    16	// Give vertex-only 4D shapes the edges of their convex hull instead (see hull.h)
+#define LIBRARY_HULL_ROUNDED 32	// With LIBRARY_HULL, merge cells that are flat to within float rounding
+
+typedef struct {
+    ShapeEntry* entries;
+    int count;
+    int flags;
+    WorkerPool* pool;
+    pthread_mutex_t lock;
+    pthread_cond_t state_changed;
+} ShapeLibrary;
+
+// Scan dirpath for .shape/.shapeb files, returns 0 if nothing usable was found.
+// A NULL dirpath opens an empty library for library_generate()
+int library_open(ShapeLibrary* lib, const char* dirpath, int flags);
+// Append a shape built from a generator spec (see generators.h). Only before shapes are fetched, 0 on failure
+int library_generate(ShapeLibrary* lib, const char* spec);
+void library_close(ShapeLibrary* lib);
+
+// Loaded shape at idx, loading it on this thread (or waiting for a prefetch) if needed. NULL on failure
+Polyhedron* library_get(ShapeLibrary* lib, int idx);
+// Start loading idx in the background if it isn't loaded yet
+void library_prefetch(ShapeLibrary* lib, int idx);
+// Drop the vertex/edge data of idx, keeping its header
+void library_unload(ShapeLibrary* lib, int idx);
+int library_is_loaded(ShapeLibrary* lib, int idx);
+
+#endif
@@ -6,15 +6,26 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shapes.h"
-
-#ifdef _WIN32
-#include <windows.h>
-#else
-#include <dirent.h>
-#endif
+#include "library.h"
+#include "generators.h"
+#include "residency.h"
+#include "math4d.h"
+#include "transform.h"
+#include "stream.h"
+#include "gallery.h"
+#include "headless.h"
+#include "capture.h"
+#include "raster.h"
+#include "image.h"
+#include "timer.h"
+#include "input.h"
+#include "simclock.h"
+#include "bench.h"
 
 #define WIDTH  1200
 #define HEIGHT 800
+// Longest a paused window sleeps between checks for events
+#define IDLE_WAIT_SECONDS 0.5
 
 // Global state 
 float angle_x = 0.0f, angle_y = 0.0f;
@@ -22,140 +33,451 @@ float angle_xw = 0.0f, angle_yw = 0.0f, angle_zw = 0.0f;
 float fuzziness = 0.0f;
 int current_shape_idx = 0;
 int auto_rotate = 1;
+int verbose = 0;
+int lazy = 0;
+size_t gpu_budget_mb = 256;
+int cpu_transform = 0;
+int soa_layout = 0;
+int infer_edges_flag = 0;
+int hull_flag = 0;
+int hull_rounded = 0;
+int transform_threads = 0;
+int gallery_mode = 0;
+int headless = 0;
+char* headless_shape = NULL;
+float headless_duration = 5.0f;
+int headless_fps = 30;
+// Radians per second around x, y, xw, yw, zw, the interactive auto-rotate by default
+float headless_velocity[SIM_ANGLES] = SIM_AUTO_ROTATE;
+char* frames_dir = "frames";
+int software_renderer = 0;
+int swap_interval = 1;
+int bench_mode = 0;
+int bench_frames = 600;
+char* bench_json = NULL;
+float bench_max_jitter = 0.0f;
 
 char* dirpath = "shapes";
+int dir_given = 0;
+// Generator specs from --gen, in order
+#define MAX_GEN_SPECS 64
+char* gen_specs[MAX_GEN_SPECS];
+int gen_count = 0;
+
+// Compile and link a vertex + fragment shader pair, 0 on failure
+static GLuint build_program(const char *vertexSource, const char *fragmentSource) {
+    GLint ok;
+    char log[512];
+
+    // Compile vertex shader
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexSource, NULL);
+    glCompileShader(vertexShader);
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        glGetShaderInfoLog(vertexShader, sizeof(log), NULL, log);
+        fprintf(stderr, "Vertex shader failed to compile:\n%s\n", log);
+    }
+
+    // Compile fragment shader
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+    glCompileShader(fragmentShader);
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        glGetShaderInfoLog(fragmentShader, sizeof(log), NULL, log);
+        fprintf(stderr, "Fragment shader failed to compile:\n%s\n", log);
+    }
+
+    // Link shaders into program
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        glGetProgramInfoLog(program, sizeof(log), NULL, log);
+        fprintf(stderr, "Shader program failed to link:\n%s\n", log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// Show the finished frame, or queue it for writing when there is no window. A benchmark times the swap too
+static void present_frame(GLFWwindow *window, FrameCapture *capture, Bench *bench) {
+    if (bench_mode) bench_end_gpu(bench);
+    if (window) glfwSwapBuffers(window);
+    else if (!bench_mode) capture_frame(capture);
+    if (bench_mode) bench_end_frame(bench);
+}
+
+// Angles straight from the frame's time, so any frame can be rendered on its own
+static void headless_angles(int frame) {
+    float t = (float)frame / headless_fps;
+    angle_x = headless_velocity[0] * t;
+    angle_y = headless_velocity[1] * t;
+    angle_xw = headless_velocity[2] * t;
+    angle_yw = headless_velocity[3] * t;
+    angle_zw = headless_velocity[4] * t;
+}
+
+// No GL at all: the CPU transform projects, the tile rasterizer draws and frames are written like --headless
+static int render_software(ShapeLibrary *library) {
+    Polyhedron *p = library_get(library, current_shape_idx);
+    if (!p || !image_make_dir(frames_dir)) {
+        return 0;
+    }
+    int threads = transform_threads > 0 ? transform_threads : pool_cpu_count();
+    WorkerPool *pool = threads > 1 ? pool_create(threads - 1) : NULL;
+    float *projected = alloc_aligned(sizeof(float) * 2 * (p->v_count > 0 ? p->v_count : 1));
+    Raster raster;
+    if (!projected || !raster_init(&raster, WIDTH, HEIGHT, pool)) {
+        fprintf(stderr, "Out of memory for the software renderer\n");
+        free_aligned(projected);
+        pool_destroy(pool);
+        return 0;
+    }
+
+    int frame_total = (int)(headless_duration * headless_fps + 0.5f);
+    double render_seconds = 0.0;
+    int ok = 1;
+    for (int frame = 0; ok && frame < frame_total; frame++) {
+        headless_angles(frame);
+        double start = timer_now();
+        if (p->coords) {
+            MatN transform = view_transform_n(p->dim, angle_x, angle_y, angle_xw, angle_yw, angle_zw);
+            transform_shape_n(pool, &transform, &default_projection, p, projected);
+        }
+        else {
+            Mat4 transform = view_transform(p->is_4d, angle_x, angle_y, angle_xw, angle_yw, angle_zw);
+            transform_shape_parallel(pool, &transform, &default_projection, p, projected);
+        }
+        ok = raster_draw(&raster, projected, p->v_count, p->edges, p->e_count);
+        render_seconds += timer_now() - start;
+
+        char path[600];
+        snprintf(path, sizeof(path), "%s/frame_%05d.ppm", frames_dir, frame);
+        ok = ok && image_write_ppm(path, raster.pixels, WIDTH, HEIGHT, 0);
+    }
+    if (ok) fprintf(stdout, "Wrote %d frames to %s\n", frame_total, frames_dir);
+    if (ok && verbose) {
+        fprintf(stdout, "Software renderer: %.2f ms per frame for %d edges on %d threads\n",
+                render_seconds * 1000.0 / frame_total, p->e_count, threads);
+    }
+
+    raster_destroy(&raster);
+    free_aligned(projected);
+    pool_destroy(pool);
+    return ok;
+}
 
 int main(int argc, char* argv[]) {
     // Hide Terminal Cursor
     system("echo -e \e[?25l");
-    // Check if shapes dir arg was sent
-    if(argc > 1) {
-        for (int i = 1; i < argc; i++) {
-            if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
-                fprintf(stdout, "Usage: polyhedra [OPTION]... \n"
-                                "Provide Interesting Visualizations of the .shape files in the specified directory.\n"
-                                "\n"
-                                "   -d, --dir[DIRECTORY]   Looks in the specified directory for.shape files.\n"
-                                "   -h, --help              Shows this dialogue.\n\n"
-                                );
+    // Parse arguments
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            fprintf(stdout, "Usage: polyhedra [OPTION]... \n"
+                            "Provide Interesting Visualizations of the .shape files in the specified directory.\n"
+                            "\n"
+                            "   -d, --dir[DIRECTORY]   Looks in the specified directory for .shape/.shapeb files.\n"
+                            "   --gen[SPEC]             Add a generated shape like hypercube:6 or sphere:200x200, \"--gen list\" lists them.\n"
+                            "                           Replaces the directory unless --dir is given too. Repeatable.\n"
+                            "   -v, --verbose           Reports how long each shape took to load.\n"
+                            "   --infer-edges           Connect the nearest vertices of shapes that list no edges, like vertex-only files.\n"
+                            "   --hull                  Draw the convex hull of 4D shapes that list no edges, -v reports its cells and timings.\n"
+                            "   --hull-rounded          The same for polytopes written out as floats, merging cells flat to within rounding.\n"
+                            "   --lazy                  Only read shape headers at startup, load shapes when first shown.\n"
+                            "   --budget[MB]            GPU memory shared by all shapes in --lazy mode (default 256).\n"
+                            "   --cpu                   Rotate and project vertices on the CPU instead of in the vertex shader.\n"
+                            "   --soa                   Store vertices as separate x/y/z(/w) arrays for the --cpu path.\n"
+                            "   --threads[N]            Threads projecting large shapes on the --cpu path (default: all cores).\n"
+                            "   --gallery               Draw every shape at once in a grid.\n"
+                            "   --headless              Render offscreen without a display and write frames instead of showing them.\n"
+                            "   --shape[NAME]           Shape to render in --headless mode, by file or shape name (default: the first).\n"
+                            "   --duration[SECONDS]     Length of the --headless animation (default 5).\n"
+                            "   --fps[N]                Frames written per second of --headless animation (default 30).\n"
+                            "   --velocity[X,Y,XW,YW,ZW]  Rotation speeds in radians per second for --headless mode.\n"
+                            "   --out[DIRECTORY]        Where --headless writes frame_00000.ppm onwards (default frames).\n"
+                            "   --bench[NAME]           Time a fixed rotation of one shape with vsync off and print the results as JSON.\n"
+                            "   --frames[N]             Frames recorded by --bench (default 600).\n"
+                            "   --json[FILE]            Also write the --bench results to FILE.\n"
+                            "   --max-jitter[RATIO]     Fail --bench when the p99 frame time is over RATIO times the median.\n"
+                            "   --interval[N]           Screen refreshes per frame: 0 uncapped, 1 vsync (default), 2 half rate.\n"
+                            "   --renderer=software     Rasterize on the CPU without any GL driver, writes frames like --headless.\n"
+                            "   -h, --help              Shows this dialogue.\n\n"
+                            );
+            return(0);
+        }
+        else if (strcmp(argv[i], "--dir") == 0 || strcmp(argv[i], "-d") == 0) {
+            if (argv[i+1] == NULL) {
+                fprintf(stdout, "%s: missing operand\nTry \"%s --help\" for more information.\n\n", argv[0], argv[0]);
+                return(0);
+            }
+            dirpath = argv[++i];
+            dir_given = 1;
+        }
+        else if (strcmp(argv[i], "--gen") == 0) {
+            if (argv[i+1] == NULL) {
+                fprintf(stdout, "%s: missing operand\nTry \"%s --help\" for more information.\n\n", argv[0], argv[0]);
+                return(0);
+            }
+            if (strcmp(argv[++i], "list") == 0) {
+                fprintf(stdout, "Generators:\n");
+                generator_list(stdout);
+                fprintf(stdout, "\n");
+                return(0);
+            }
+            if (gen_count == MAX_GEN_SPECS) {
+                fprintf(stdout, "%s: at most %d \"--gen\" shapes\n\n", argv[0], MAX_GEN_SPECS);
+                return(0);
+            }
+            gen_specs[gen_count++] = argv[i];
+        }
+        else if (strcmp(argv[i], "--verbose") == 0 || strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        }
+        else if (strcmp(argv[i], "--cpu") == 0) {
+            cpu_transform = 1;
+        }
+        else if (strcmp(argv[i], "--soa") == 0) {
+            soa_layout = 1;
+        }
+        else if (strcmp(argv[i], "--infer-edges") == 0) {
+            infer_edges_flag = 1;
+        }
+        else if (strcmp(argv[i], "--hull") == 0 || strcmp(argv[i], "--hull-rounded") == 0) {
+            hull_flag = 1;
+            hull_rounded = strcmp(argv[i], "--hull-rounded") == 0;
+        }
+        else if (strcmp(argv[i], "--threads") == 0) {
+            if (argv[i+1] == NULL) {
+                fprintf(stdout, "%s: missing operand\nTry \"%s --help\" for more information.\n\n", argv[0], argv[0]);
+                return(0);
+            }
+            transform_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--gallery") == 0) {
+            gallery_mode = 1;
+        }
+        else if (strcmp(argv[i], "--headless") == 0) {
+            headless = 1;
+        }
+        else if (strcmp(argv[i], "--shape") == 0 || strcmp(argv[i], "--duration") == 0 || strcmp(argv[i], "--fps") == 0 ||
+                 strcmp(argv[i], "--velocity") == 0 || strcmp(argv[i], "--out") == 0) {
+            if (argv[i+1] == NULL) {
+                fprintf(stdout, "%s: missing operand\nTry \"%s --help\" for more information.\n\n", argv[0], argv[0]);
                 return(0);
             }
-            else if ((strcmp(argv[i], "--dir") == 0 || strcmp(argv[i], "-d") == 0) && argv[i+1] != NULL) {
-                dirpath = argv[i + 1];
-                goto pass;
+            char *option = argv[i++];
+            if (strcmp(option, "--shape") == 0) headless_shape = argv[i];
+            else if (strcmp(option, "--duration") == 0) headless_duration = (float)atof(argv[i]);
+            else if (strcmp(option, "--fps") == 0) headless_fps = atoi(argv[i]);
+            else if (strcmp(option, "--out") == 0) frames_dir = argv[i];
+            else if (sscanf(argv[i], "%f,%f,%f,%f,%f", &headless_velocity[0], &headless_velocity[1], &headless_velocity[2],
+                            &headless_velocity[3], &headless_velocity[4]) != 5) {
+                fprintf(stdout, "%s: \"--velocity\" takes five comma separated numbers\n\n", argv[0]);
+                return(0);
+            }
+        }
+        else if (strcmp(argv[i], "--bench") == 0 || strcmp(argv[i], "--frames") == 0 || strcmp(argv[i], "--json") == 0 ||
+                 strcmp(argv[i], "--max-jitter") == 0) {
+            if (argv[i+1] == NULL) {
+                fprintf(stdout, "%s: missing operand\nTry \"%s --help\" for more information.\n\n", argv[0], argv[0]);
+                return(0);
+            }
+            char *option = argv[i++];
+            if (strcmp(option, "--bench") == 0) {
+                bench_mode = 1;
+                headless_shape = argv[i];
             }
+            else if (strcmp(option, "--frames") == 0) bench_frames = atoi(argv[i]);
+            else if (strcmp(option, "--max-jitter") == 0) bench_max_jitter = (float)atof(argv[i]);
+            else bench_json = argv[i];
         }
-        fprintf(stdout, "%s: missing operand\nTry \"%s --help\" for more information.\n\n", argv[0], argv[0]);
+        else if (strcmp(argv[i], "--interval") == 0) {
+            if (argv[i+1] == NULL) {
+                fprintf(stdout, "%s: missing operand\nTry \"%s --help\" for more information.\n\n", argv[0], argv[0]);
+                return(0);
+            }
+            swap_interval = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--renderer=software") == 0 || strcmp(argv[i], "--renderer=gl") == 0) {
+            software_renderer = strcmp(argv[i], "--renderer=software") == 0;
+        }
+        else if (strcmp(argv[i], "--lazy") == 0) {
+            lazy = 1;
+        }
+        else if (strcmp(argv[i], "--budget") == 0) {
+            if (argv[i+1] == NULL) {
+                fprintf(stdout, "%s: missing operand\nTry \"%s --help\" for more information.\n\n", argv[0], argv[0]);
+                return(0);
+            }
+            gpu_budget_mb = (size_t)strtoul(argv[++i], NULL, 10);
+        }
+        else {
+            fprintf(stdout, "%s: unrecognized option \"%s\"\nTry \"%s --help\" for more information.\n\n", argv[0], argv[i], argv[0]);
+            return(0);
+        }
+    }
+    // The gallery draws the static shapes from the shared buffers, all of them resident
+    if (gallery_mode && (cpu_transform || lazy)) {
+        fprintf(stdout, "%s: \"--gallery\" can't be combined with \"%s\"\n\n", argv[0], cpu_transform ? "--cpu" : "--lazy");
         return(0);
     }
 
-    pass:
-
-    // Initialize GLFW
-    if (!glfwInit()) {
-        fprintf(stderr, "Failed to initialize GLFW\n");
-        return -1;
+    // Without GL there is no window either, frames go to disk
+    if (software_renderer) {
+        if (gallery_mode) {
+            fprintf(stdout, "%s: \"--gallery\" needs \"--renderer=gl\"\n\n", argv[0]);
+            return(0);
+        }
+        headless = 1;
     }
-    // Request OpenGL 3.3 core
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Polyhedra",  NULL, NULL);
-    if (!window) {
-        fprintf(stderr, "Failed to open GLFW window\n");
-        glfwTerminate();
-        return -1;
+    // A benchmark renders one shape through GL, in a window unless --headless
+    if (bench_mode) {
+        if (gallery_mode || software_renderer) {
+            fprintf(stdout, "%s: \"--bench\" can't be combined with \"%s\"\n\n", argv[0],
+                    gallery_mode ? "--gallery" : "--renderer=software");
+            return(0);
+        }
+        if (bench_frames <= 0) {
+            fprintf(stdout, "%s: \"--frames\" must be positive\n\n", argv[0]);
+            return(0);
+        }
+        swap_interval = 0;
     }
-    glfwMakeContextCurrent(window);
-    glfwSwapInterval(1); // Enable vsync
-
-    // Load OpenGL functions using GLAD
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        fprintf(stderr, "Failed to initialize GLAD\n");
-        return -1;
+    if (headless && (headless_fps <= 0 || headless_duration <= 0.0f)) {
+        fprintf(stdout, "%s: \"--fps\" and \"--duration\" must be positive\n\n", argv[0]);
+        return(0);
     }
-    glViewport(0, 0, WIDTH, HEIGHT);
 
-    char** files = NULL;
-    int file_count = 0;
-    Polyhedron* shapes = NULL;
-    int shape_count = 0;
-
-    #ifdef _WIN32
-    // WINDOWS BASED SYSTEMS USE THIS
-    WIN32_FIND_DATAA findData;
-    char searchPath[256];
-    sprintf(searchPath, "%s\\*.shape", dirpath);
-
-    HANDLE hFind = FindFirstFileA(searchPath, &findData);
-    if (hFind == INVALID_HANDLE_VALUE) {
-        fprintf(stderr, "Failed to open directory: %s\n", dirpath);
-        return(-1);
-    }
-
-    // Populate the Array of files, NTFS Should sort it Alphanumerically, FAT will likely be off
-    do {
-        files = realloc(files, sizeof(char*) * (file_count + 1));
-        files[file_count] = _strdup(findData.cFileName);
-        file_count++;
-    } while (FindNextFileA(hFind, &findData));
-
-    FindClose(hFind);
-    #else
-    // POSIX COMPLIANT SYSTEMS USE THIS
-    // Load shapes in from specified folder
-    DIR *dir;
-    if((dir = opendir(dirpath)) == NULL) {
-        fprintf(stderr, "Failed to open directory: %s\n", dirpath);
+    // Find shapes, loading them all now unless lazy
+    ShapeLibrary library;
+    int library_flags = (lazy ? LIBRARY_LAZY : 0) | (verbose ? LIBRARY_VERBOSE : 0) | (soa_layout ? LIBRARY_SOA : 0)
+                      | (infer_edges_flag ? LIBRARY_INFER : 0)
+                      | (hull_flag ? LIBRARY_HULL : 0) | (hull_rounded ? LIBRARY_HULL_ROUNDED : 0);
+    if (!library_open(&library, gen_count > 0 && !dir_given ? NULL : dirpath, library_flags)) {
         return -1;
     }
-
-    struct dirent *ent;
-
-    // Collect filenames to sort
-    while ((ent = readdir(dir)) != NULL) {
-        if (strstr(ent->d_name, ".shape")) {
-            files = realloc(files, sizeof(char*) * (file_count + 1));
-            files[file_count] = strdup(ent->d_name);
-            file_count++;
+    for(int i = 0; i < gen_count; i++) {
+        if (!library_generate(&library, gen_specs[i])) {
+            library_close(&library);
+            return -1;
         }
     }
-    closedir(dir);
-
-    if (file_count == 0) {
-        fprintf(stderr, "No shapes found in %s\n", dirpath);
-        return -1;
+    int shape_count = library.count;
+    if (headless_shape) {
+        current_shape_idx = -1;
+        for(int i = 0; i < shape_count; i++) {
+            if (strcmp(library.entries[i].file, headless_shape) == 0 || strcmp(library.entries[i].shape.name, headless_shape) == 0) {
+                current_shape_idx = i;
+                break;
+            }
+        }
+        if (current_shape_idx < 0) {
+            fprintf(stderr, "No shape named %s in %s\n", headless_shape, dirpath);
+            return -1;
+        }
     }
 
-    // Alphanumerical Sort
-    int cmp(const void *a, const void *b) {
-        return strcmp(*(const char **)a, *(const char**)b);
+    if (software_renderer) {
+        int ok = render_software(&library);
+        library_close(&library);
+        return ok ? 0 : -1;
     }
-    qsort(files, file_count, sizeof(char*), cmp);
-
-    #endif
 
-    // Load Individual Files
-    for(int i = 0; i < file_count; i++) {
-        char path[256];
-        sprintf(path, "%s/%s", dirpath, files[i]);
-        // Put found shapes into arr in alphanumerical order
-        shapes = realloc(shapes, sizeof(Polyhedron) * (shape_count + 1));
-        if(load_shape(path, &shapes[shape_count])){
-            shape_count++;
-        } else {
-            fprintf(stderr, "Shape \"%s/%s\" failed to intialize\n", dirpath, files[i]);
+    GLFWwindow* window = NULL;
+    InputQueue input = {0};
+    Headless offscreen = {0};
+    GLADloadproc gl_loader;
+    if (headless) {
+        // Offscreen framebuffer instead of a window, no display or GPU needed
+        if (!headless_init(&offscreen, WIDTH, HEIGHT)) {
+            return -1;
         }
+        gl_loader = headless_loader();
     }
+    else {
+        // Initialize GLFW
+        if (!glfwInit()) {
+            fprintf(stderr, "Failed to initialize GLFW\n");
+            return -1;
+        }
+        // Request OpenGL 3.3 core
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        window = glfwCreateWindow(WIDTH, HEIGHT, "Polyhedra",  NULL, NULL);
+        if (!window) {
+            fprintf(stderr, "Failed to open GLFW window\n");
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSwapInterval(swap_interval); // Vsync unless --interval says otherwise
+        input_attach(&input, window);
+
+        // Load OpenGL functions using GLAD
+        gl_loader = (GLADloadproc)glfwGetProcAddress;
+        if (!gladLoadGLLoader(gl_loader)) {
+            fprintf(stderr, "Failed to initialize GLAD\n");
+            return -1;
+        }
+    }
+    glViewport(0, 0, WIDTH, HEIGHT);
 
     // Build simple shader program (vertex + fragment)
+    // CPU path: vertices arrive already projected to NDC
     const char *vertexShaderSource =
         "#version 330 core\n"
         "layout(location=0) in vec2 aPos;\n"
         "void main() {\n"
         "    gl_Position = vec4(aPos.x, aPos.y, 0.0, 1.0);\n"
         "}\n";
+    // GPU path: original 4D vertices, same rotation and projection as the CPU loop below
+    const char *transformShaderSource =
+        "#version 330 core\n"
+        "layout(location=0) in vec4 aVertex;\n"
+        "uniform mat4 uTransform;\n"
+        "uniform bool uIs4d;\n"
+        "uniform vec4 uProjection;\n"	// w_distance, w_scale, distance, z_scale
+        "uniform float uFocal;\n"
+        "void main() {\n"
+        "    vec4 v = uTransform * aVertex;\n"
+        "    vec3 p = v.xyz;\n"
+        "    if (uIs4d) p *= 1.0 / (uProjection.x - v.w * uProjection.y);\n"
+        "    float factor = uFocal / (uProjection.z - p.z * uProjection.w);\n"
+        "    gl_Position = vec4(p.xy * factor, 0.0, 1.0);\n"
+        "}\n";
+    // Gallery: the same per shape, transform and grid cell looked up from the vertex's shape
+    const char *galleryShaderSource =
+        "#version 330 core\n"
+        "layout(location=0) in vec4 aVertex;\n"
+        "uniform samplerBuffer uSlots;\n"	// Per shape: transform rows, then cell x, cell y, scale, is_4d
+        "uniform isamplerBuffer uStarts;\n"	// First vertex of each shape, ascending
+        "uniform int uRangeCount;\n"
+        "uniform vec4 uProjection;\n"
+        "uniform float uFocal;\n"
+        "void main() {\n"
+        "    int lo = 0, hi = uRangeCount - 1;\n"
+        "    while (lo < hi) {\n"
+        "        int mid = (lo + hi + 1) / 2;\n"
+        "        if (texelFetch(uStarts, mid).r <= gl_VertexID) lo = mid; else hi = mid - 1;\n"
+        "    }\n"
+        "    int slot = lo * 5;\n"
+        "    vec4 v = aVertex * mat4(texelFetch(uSlots, slot), texelFetch(uSlots, slot + 1),\n"
+        "                            texelFetch(uSlots, slot + 2), texelFetch(uSlots, slot + 3));\n"
+        "    vec4 cell = texelFetch(uSlots, slot + 4);\n"
+        "    vec3 p = v.xyz;\n"
+        "    if (cell.w != 0.0) p *= 1.0 / (uProjection.x - v.w * uProjection.y);\n"
+        "    float factor = uFocal / (uProjection.z - p.z * uProjection.w);\n"
+        "    gl_Position = vec4(cell.xy + p.xy * factor * cell.z, 0.0, 1.0);\n"
+        "}\n";
     const char *fragmentShaderSource =
         "#version 330 core\n"
         "out vec4 FragColor;\n"
@@ -163,200 +485,382 @@ int main(int argc, char* argv[]) {
         "    FragColor = vec4(1.0);\n"
         "}\n";
 
-    // Compile vertex shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    // (Skipping error checks for brevity)
-
-    // Compile fragment shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    // Link shaders into program
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    // (Skipping error checks)
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    GLuint shaderProgram = build_program(cpu_transform ? vertexShaderSource :
+                                         gallery_mode ? galleryShaderSource : transformShaderSource, fragmentShaderSource);
+    if (!shaderProgram) {
+        return -1;
+    }
     glUseProgram(shaderProgram);
+    GLint transformLoc = glGetUniformLocation(shaderProgram, "uTransform");
+    GLint is4dLoc = glGetUniformLocation(shaderProgram, "uIs4d");
+    const Projection *proj = &default_projection;
+    glUniform4f(glGetUniformLocation(shaderProgram, "uProjection"), proj->w_distance, proj->w_scale, proj->distance, proj->z_scale);
+    glUniform1f(glGetUniformLocation(shaderProgram, "uFocal"), proj->focal);
+    Gallery gallery = {0};
+    if (gallery_mode) gallery_init(&gallery, shaderProgram, shape_count);
+
+    // CPU path: projected vertices stream through one ring buffer sized by the largest shape
+    // (header counts are known even in lazy mode), written in place by the transform
+    int max_v_count = 0;
+    for(int i = 0; i < shape_count; i++) {
+        if (library.entries[i].shape.v_count > max_v_count) max_v_count = library.entries[i].shape.v_count;
+    }
+    StreamBuffer stream = {0};
+    if (cpu_transform) {
+        if (!stream_init(&stream, sizeof(float) * 2 * max_v_count, gl_loader)) {
+            fprintf(stderr, "Failed to create stream buffer for %d vertices\n", max_v_count);
+            return -1;
+        }
+        if (verbose) {
+            fprintf(stdout, "Vertex stream: %s, %d x %zu bytes\n", stream.persistent ? "persistent mapping" : "orphaning",
+                    STREAM_REGIONS, stream.region_size);
+        }
+    }
 
-    // Prepare VAOs/VBOs/EBOs for each shape
-    GLuint *VAOs = malloc(sizeof(GLuint) * shape_count);
-    GLuint *VBOs = malloc(sizeof(GLuint) * shape_count);
-    GLuint *EBOs = malloc(sizeof(GLuint) * shape_count);
-    glGenVertexArrays(shape_count, VAOs);
-    glGenBuffers(shape_count, VBOs);
-    glGenBuffers(shape_count, EBOs);
+    // All shapes share one vertex and one index buffer. Eager mode sizes them for everything,
+    // lazy mode splits the budget between them in proportion to the library and evicts to fit
+    ResidencyMode mode = cpu_transform ? RESIDENCY_PROJECTED : RESIDENCY_SOURCE;
+    size_t vertex_total = 0, index_total = 0;
     for(int i = 0; i < shape_count; i++) {
-        glBindVertexArray(VAOs[i]);
-        // Vertex buffer (we will update it dynamically)
-        glBindBuffer(GL_ARRAY_BUFFER, VBOs[i]);
-        glBufferData(GL_ARRAY_BUFFER, shapes[i].v_count * 2 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        // Edge index buffer
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOs[i]);
-        int edgeCount = shapes[i].e_count;
-        int *indices = (int*)malloc(edgeCount * 2 * sizeof(int));
-        for(int j = 0; j < edgeCount; j++) {
-            indices[2*j]   = shapes[i].edges[j].start;
-            indices[2*j+1] = shapes[i].edges[j].end;
-        }
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, edgeCount * 2 * sizeof(int), indices, GL_STATIC_DRAW);
-        free(indices);
-        glBindVertexArray(0);
+        vertex_total += residency_vertex_bytes(mode, &library.entries[i].shape);
+        index_total += residency_index_bytes(&library.entries[i].shape);
+    }
+    size_t vertex_capacity = vertex_total, index_capacity = index_total;
+    size_t budget = gpu_budget_mb * 1024 * 1024;
+    if (lazy && vertex_total + index_total > budget) {
+        vertex_capacity = (size_t)((double)budget * vertex_total / (vertex_total + index_total));
+        index_capacity = budget - vertex_capacity;
+    }
+    Residency residency;
+    residency_init(&residency, shape_count, vertex_capacity, index_capacity, mode, stream.buffer);
+    if (!lazy) {
+        for(int i = 0; i < shape_count; i++) {
+            Polyhedron *shape = library_get(&library, i);
+            if (shape) residency_acquire(&residency, i, shape);
+        }
+    }
+    int prefetched_idx = -1;
+    // Shapes above 4D are rotated on the CPU on both paths, the shader path gets their 4D shadow each frame
+    int max_nd_count = 0;
+    for(int i = 0; i < shape_count; i++) {
+        const Polyhedron *header = &library.entries[i].shape;
+        if (header->dim > 4 && header->v_count > max_nd_count) max_nd_count = header->v_count;
+    }
+    Vertex *shadow = NULL;
+    if (!cpu_transform && max_nd_count > 0) {
+        shadow = malloc(sizeof(Vertex) * max_nd_count);
+        if (!shadow) {
+            fprintf(stderr, "Out of memory for %d vertices\n", max_nd_count);
+            return -1;
+        }
+    }
+
+    // Persistent workers for projecting large shapes, the main thread makes up the last one
+    WorkerPool *transform_pool = NULL;
+    if (cpu_transform || max_nd_count > 0) {
+        int threads = transform_threads > 0 ? transform_threads : pool_cpu_count();
+        if (threads > 1) transform_pool = pool_create(threads - 1);
+        if (verbose) {
+            fprintf(stdout, "CPU transform kernel: %s, %d threads above %d vertices\n",
+                    transform_kernel_name(transform_best_kernel()), threads, TRANSFORM_PARALLEL_MIN);
+        }
     }
 
     glLineWidth(2.0f);
     glClearColor(0.0, 0.0, 0.0, 1.0);
 
-    // Allocate buffer for transformed vertices
-    float vertexBuffer[2500];
-
     // Frametime and Framerate
     float lastTime = 0.0f;
     int frameCount = 0;
     bool fps_toggle = false;
 
+    // What the window currently shows, a frame is only redrawn once any of it changes
+    float drawn_angles[5] = {0};
+    int drawn_shape = -1;
+    bool presented = true;
+
+    // Rotation steps at a fixed rate whatever the frame rate, frames show it interpolated
+    SimClock sim;
+    float auto_velocity[SIM_ANGLES] = SIM_AUTO_ROTATE;
+    sim_init(&sim, headless ? 0.0 : glfwGetTime());
+
+    // Headless: every frame is read back and written out, the animation is a fixed number of frames
+    FrameCapture capture = {0};
+    int frame_total = (int)(headless_duration * headless_fps + 0.5f);
+    if (headless && !bench_mode && !capture_init(&capture, frames_dir, WIDTH, HEIGHT)) {
+        return -1;
+    }
+    // Benchmark: the same scripted rotation every run, timed frame by frame
+    Bench bench = {0};
+    if (bench_mode && !bench_init(&bench, bench_frames)) {
+        fprintf(stderr, "Out of memory for %d benchmark frames\n", bench_frames);
+        return -1;
+    }
+
+    // Last shape reported as not fitting in GPU memory
+    int unplaced_shape = -1;
+
     // Main loop
-    while (!glfwWindowShouldClose(window)) {
-        if (fps_toggle) {
-            // Call Time to determine Frame Count
-            double currentTime = glfwGetTime();
-            frameCount++;
-
-            if (currentTime - lastTime >= 1.0f) { // One Second Has Passed
-                fprintf(stdout, "FPS: %d\n", frameCount);
-                frameCount = 0;
-                lastTime = currentTime;
+    while (bench_mode ? bench.frame < bench.total : headless ? capture.frame < frame_total : !glfwWindowShouldClose(window)) {
+        if (bench_mode) {
+            // Only closing the window stops it early
+            if (window) {
+                glfwPollEvents();
+                if (glfwWindowShouldClose(window)) break;
             }
+            headless_angles(bench.frame);
+            bench_begin_frame(&bench);
         }
-
-        // Input handling
-        glfwPollEvents();
-        // Use Arrow Keys to Cycle
-        if (glfwGetKey(window, GLFW_KEY_KP_ADD) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS) {
-            current_shape_idx = (current_shape_idx + 1) % shape_count;
-            while(glfwGetKey(window, GLFW_KEY_KP_ADD) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS) glfwPollEvents();
-        }
-        if (glfwGetKey(window, GLFW_KEY_KP_SUBTRACT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS) {
-            current_shape_idx = current_shape_idx == 0 ? shape_count-1 : current_shape_idx-1;
-            while(glfwGetKey(window, GLFW_KEY_KP_SUBTRACT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS) glfwPollEvents();
-        }
-
-        // Toggle auto-rotate
-        if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
-            auto_rotate = !auto_rotate;
-            // simple debounce
-            while(glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) glfwPollEvents();
-        }
-        // Quit on Q
-        if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
-            break;
-        }
-        // Rotation keys
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) angle_x -= 0.01f;
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) angle_x += 0.01f;
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) angle_y += 0.01f;
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) angle_y -= 0.01f;
-        if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) angle_xw -= 0.01f;
-        if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) angle_xw += 0.01f;
-        if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) angle_yw -= 0.01f;
-        if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) angle_yw += 0.01f;
-        if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS) angle_zw -= 0.01f;
-        if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS) angle_zw += 0.01f;
-        if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) fps_toggle = !fps_toggle;
-
-        if (auto_rotate) {
-            angle_x += 0.004f;
-            angle_y += 0.006f;
-            angle_xw += 0.003f;
-            angle_yw += 0.002f;
-            angle_zw += 0.005f;
+        else if (headless) {
+            headless_angles(capture.frame);
+        }
+        else {
+            // Input handling, every queued key press handled once.
+            // After a skipped frame nothing is moving, so sleep until something happens
+            if (presented) {
+                glfwPollEvents();
+            }
+            else {
+                glfwWaitEventsTimeout(IDLE_WAIT_SECONDS);
+                // Nothing moved while asleep, rotation picks up from now rather than catching up
+                sim_resync(&sim, glfwGetTime());
+            }
+            KeyEvent event;
+            int quit = 0;
+            while (input_next(&input, &event)) {
+                if (event.action == GLFW_RELEASE) continue;
+                // Holding +/- keeps cycling at the key repeat rate, toggles only flip on the press itself
+                switch (event.key) {
+                case GLFW_KEY_KP_ADD:
+                case GLFW_KEY_EQUAL:
+                    current_shape_idx = (current_shape_idx + 1) % shape_count;
+                    break;
+                case GLFW_KEY_KP_SUBTRACT:
+                case GLFW_KEY_MINUS:
+                    current_shape_idx = current_shape_idx == 0 ? shape_count-1 : current_shape_idx-1;
+                    break;
+                case GLFW_KEY_R:
+                    if (event.action == GLFW_PRESS) auto_rotate = !auto_rotate;
+                    break;
+                case GLFW_KEY_F:
+                    if (event.action == GLFW_PRESS) fps_toggle = !fps_toggle;
+                    break;
+                case GLFW_KEY_Q:
+                    quit = 1;
+                    break;
+                }
+            }
+            // Quit on Q
+            if (quit) {
+                break;
+            }
+            // Rotation keys, for as long as they are held, on top of auto-rotate
+            static const int rotation_keys[SIM_ANGLES][2] = {
+                { GLFW_KEY_S, GLFW_KEY_W }, { GLFW_KEY_D, GLFW_KEY_A }, { GLFW_KEY_K, GLFW_KEY_I },
+                { GLFW_KEY_L, GLFW_KEY_J }, { GLFW_KEY_O, GLFW_KEY_U },
+            };
+            for (int a = 0; a < SIM_ANGLES; a++) {
+                sim.velocity[a] = auto_rotate ? auto_velocity[a] : 0.0f;
+                if (input_held(&input, rotation_keys[a][0])) sim.velocity[a] += SIM_KEY_SPEED;
+                if (input_held(&input, rotation_keys[a][1])) sim.velocity[a] -= SIM_KEY_SPEED;
+            }
+            sim_advance(&sim, glfwGetTime());
+            float angles[5];
+            sim_present(&sim, angles);
+            angle_x = angles[0];
+            angle_y = angles[1];
+            angle_xw = angles[2];
+            angle_yw = angles[3];
+            angle_zw = angles[4];
+
+            // Skip the frame when it would look exactly like the one on screen. Never while turning: just after
+            // waking no step has built up yet, and skipping would put the viewer back to sleep
+            if (!input.damaged && drawn_shape == current_shape_idx && !sim_frame_due(&sim, drawn_angles)) {
+                presented = false;
+                continue;
+            }
+            if (input.damaged) glViewport(0, 0, input.width, input.height);
+            input.damaged = 0;
+            memcpy(drawn_angles, angles, sizeof(angles));
+            drawn_shape = current_shape_idx;
+            presented = true;
+
+            if (fps_toggle) {
+                // Call Time to determine Frame Count
+                double currentTime = glfwGetTime();
+                frameCount++;
+
+                if (currentTime - lastTime >= 1.0f) { // One Second Has Passed
+                    fprintf(stdout, "FPS: %d\n", frameCount);
+                    frameCount = 0;
+                    lastTime = currentTime;
+                }
+            }
         }
 
         // Clear screen
         glClear(GL_COLOR_BUFFER_BIT);
 
+        if (gallery_mode) {
+            float aspect = input.height > 0 ? (float)input.width / input.height : (float)WIDTH / HEIGHT;
+            gallery_draw(&gallery, &residency, &library, transform_pool, proj, shadow,
+                         angle_x, angle_y, angle_xw, angle_yw, angle_zw, aspect);
+            present_frame(window, &capture, &bench);
+            continue;
+        }
+
         // Compute transformed vertices for current shape (with 4D projection if needed)
-        Polyhedron *p = &shapes[current_shape_idx];
-        for(int i = 0; i < p->v_count; i++) {
-            // Original 4D coords
-            float x = p->vertices[i].x;
-            float y = p->vertices[i].y;
-            float z = p->vertices[i].z;
-            float w = p->vertices[i].w;
-
-            // 4D Rotations (for tesseract and hypersphere)
-            if (p->is_4d) {
-                // Rotate in xw plane
-                float cos_xw = cosf(angle_xw), sin_xw = sinf(angle_xw);
-                float nx = x * cos_xw - w * sin_xw;
-                float nw = x * sin_xw + w * cos_xw;
-                x = nx; w = nw;
-                // Rotate in yw plane
-                float cos_yw = cosf(angle_yw), sin_yw = sinf(angle_yw);
-                float ny = y * cos_yw - w * sin_yw;
-                nw = y * sin_yw + w * cos_yw;
-                y = ny; w = nw;
-                // Rotate in zw plane
-                float cos_zw = cosf(angle_zw), sin_zw = sinf(angle_zw);
-                float nz = z * cos_zw - w * sin_zw;
-                nw = z * sin_zw + w * cos_zw;
-                z = nz; w = nw;
+        Polyhedron *p = library_get(&library, current_shape_idx);
+        if (!p) {
+            // Failed to load, nothing to draw
+            present_frame(window, &capture, &bench);
+            continue;
+        }
+
+        // Only if the file changed on disk since the header scan
+        if (cpu_transform && p->v_count > max_v_count) {
+            stream_destroy(&stream);
+            if (!stream_init(&stream, sizeof(float) * 2 * p->v_count, gl_loader)) {
+                fprintf(stderr, "Failed to create stream buffer for %d vertices\n", p->v_count);
+                break;
             }
+            residency_set_projected_buffer(&residency, stream.buffer);
+            max_v_count = p->v_count;
+        }
 
-            // Rotate around X axis
-            float temp_y = y * cosf(angle_x) - z * sinf(angle_x);
-            float temp_z = y * sinf(angle_x) + z * cosf(angle_x);
-            y = temp_y; z = temp_z;
-
-            // Rotate around Y axis
-            float temp_x = x * cosf(angle_y) + z * sinf(angle_y);
-            temp_z = -x * sinf(angle_y) + z * cosf(angle_y);
-            x = temp_x; z = temp_z;
-
-            // 4D -> 3D perspective (for tesseract/hypersphere)
-            if (p->is_4d) {
-                float w_factor = 1.0f / (2.0f - w * 0.3f);
-                x *= w_factor;
-                y *= w_factor;
-                z *= w_factor;
+        if (lazy && prefetched_idx != current_shape_idx) {
+            // Warm up both neighbours and drop CPU copies that are neither on the GPU nor next in line
+            int next = (current_shape_idx + 1) % shape_count;
+            int prev = current_shape_idx == 0 ? shape_count-1 : current_shape_idx-1;
+            for(int i = 0; i < shape_count; i++) {
+                if (i != current_shape_idx && i != next && i != prev && !residency.shapes[i].resident) {
+                    library_unload(&library, i);
+                }
             }
+            library_prefetch(&library, next);
+            library_prefetch(&library, prev);
+            prefetched_idx = current_shape_idx;
+        }
 
-            // 3D perspective projection
-            float distance = 4.0f;
-            float factor = 50.0f / (distance - z * 0.5f);
-            // Compute final (screen) coordinates; normalize for NDC
-            float fx = x * factor * 2.0f / 40.0f;
-            float fy = y * factor / 20.0f;
-            // Store in vertex buffer (ignoring z)
-            vertexBuffer[2*i] = fx;
-            vertexBuffer[2*i+1] = fy;
+        // Make room by dropping the shapes seen longest ago, alone it fits unless the buffers can't grow
+        double upload_start = timer_now();
+        GpuShape *placed;
+        while (!(placed = residency_acquire(&residency, current_shape_idx, p))) {
+            int victim = residency_lru(&residency, current_shape_idx);
+            if (victim < 0) break;
+            residency_evict(&residency, victim);
+            if (lazy) library_unload(&library, victim);
+        }
+        if (bench_mode) bench_add(&bench, BENCH_UPLOAD, timer_now() - upload_start);
+        if (!placed) {
+            // Said once per shape, it's retried every frame it's shown
+            if (unplaced_shape != current_shape_idx) {
+                fprintf(stderr, "No room on the GPU for %s (%d vertices, %d edges)\n", p->name, p->v_count, p->e_count);
+                unplaced_shape = current_shape_idx;
+            }
+            present_frame(window, &capture, &bench);
+            continue;
         }
 
-        // Update VBO for current shape
-        glBindVertexArray(VAOs[current_shape_idx]);
-        glBindBuffer(GL_ARRAY_BUFFER, VBOs[current_shape_idx]);
-        glBufferData(GL_ARRAY_BUFFER, p->v_count * 2 * sizeof(float), vertexBuffer, GL_DYNAMIC_DRAW);
+        // Whole rotation as one matrix, composed once per frame
+        Mat4 transform = view_transform(p->is_4d, angle_x, angle_y, angle_xw, angle_yw, angle_zw);
+        MatN transform_n;
+        if (p->coords) transform_n = view_transform_n(p->dim, angle_x, angle_y, angle_xw, angle_yw, angle_zw);
+
+        if (!cpu_transform && p->coords) {
+            double transform_seconds = 0.0, upload_seconds = 0.0;
+            residency_update_shadow(&residency, current_shape_idx, p, transform_pool, &transform_n, proj, shadow,
+                                    &transform_seconds, &upload_seconds);
+            if (bench_mode) {
+                bench_add(&bench, BENCH_TRANSFORM, transform_seconds);
+                bench_add(&bench, BENCH_UPLOAD, upload_seconds);
+            }
+            transform = mat4_identity();
+        }
 
-        // Draw edges
-        glDrawElements(GL_LINES, p->e_count * 2, GL_UNSIGNED_INT, 0);
+        if (!cpu_transform) {
+            // The vertex shader does the rest
+            glUniformMatrix4fv(transformLoc, 1, GL_TRUE, transform.m);
+            glUniform1i(is4dLoc, p->is_4d);
+
+            residency_draw(&residency, current_shape_idx, 0);
+            present_frame(window, &capture, &bench);
+            continue;
+        }
+
+        // One matrix-vector product and the perspective divides per vertex, straight into this frame's ring region
+        size_t offset;
+        double map_start = timer_now();
+        float *projected = stream_map(&stream, p->v_count * 2 * sizeof(float), &offset);
+        if (projected) {
+            double transform_start = timer_now();
+            if (p->coords) transform_shape_n(transform_pool, &transform_n, proj, p, projected);
+            else transform_shape_parallel(transform_pool, &transform, proj, p, projected);
+            double unmap_start = timer_now();
+            stream_unmap(&stream);
+            if (bench_mode) {
+                bench_add(&bench, BENCH_UPLOAD, (transform_start - map_start) + (timer_now() - unmap_start));
+                bench_add(&bench, BENCH_TRANSFORM, unmap_start - transform_start);
+            }
+
+            // Draw edges, the base vertex selects the region
+            residency_draw(&residency, current_shape_idx, (GLint)(offset / (2 * sizeof(float))));
+            stream_fence(&stream);
+        }
 
         // Swap buffers
-        glfwSwapBuffers(window);
+        present_frame(window, &capture, &bench);
     }
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    int frames_ok = 1;
+    if (bench_mode) {
+        bench_finish(&bench);
+        Polyhedron *p = library_get(&library, current_shape_idx);
+        const char *name = library.entries[current_shape_idx].shape.name;
+        const char *path = cpu_transform ? "cpu" : "shader";
+        bench_report(&bench, stdout, name, p ? p->v_count : 0, p ? p->e_count : 0, path);
+        if (bench_json) {
+            FILE *file = fopen(bench_json, "w");
+            if (file) {
+                bench_report(&bench, file, name, p ? p->v_count : 0, p ? p->e_count : 0, path);
+                fclose(file);
+            }
+            else {
+                fprintf(stderr, "Failed to write %s\n", bench_json);
+                frames_ok = 0;
+            }
+        }
+        // Hitches: a slow tail against an otherwise steady frame time
+        float p50 = bench_percentile(&bench, BENCH_FRAME, 50), p99 = bench_percentile(&bench, BENCH_FRAME, 99);
+        if (bench_max_jitter > 0.0f && p99 > bench_max_jitter * p50) {
+            fprintf(stderr, "Frame time p99 %.2f ms is %.1f times the median %.2f ms, over --max-jitter %.1f\n",
+                    p99, p99 / p50, p50, bench_max_jitter);
+            frames_ok = 0;
+        }
+        bench_destroy(&bench);
+    }
+    else if (headless) {
+        // Waits for the last frames to be written
+        frames_ok = capture_finish(&capture);
+        if (frames_ok) fprintf(stdout, "Wrote %d frames to %s\n", frame_total, frames_dir);
+    }
+    pool_destroy(transform_pool);
+    free(shadow);
+    if (gallery_mode) gallery_destroy(&gallery);
+    residency_destroy(&residency);
+    if (cpu_transform) stream_destroy(&stream);
+    library_close(&library);
+    if (window) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+    else {
+        headless_destroy(&offscreen);
+    }
 
     // Show Terminal Cursor
     system("echo -e \e[?25h");
 
-    return 0;
+    return frames_ok ? 0 : -1;
 }
 
@@ -0,0 +1,88 @@
+#include "math4d.h"
+#include <math.h>
+
+const Projection default_projection = { 2.0f, 0.3f, 4.0f, 0.5f, 2.5f };
+
+// Axis pair for each plane, x = 0 .. w = 3
+static const int plane_axes[6][2] = {
+    {0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}
+};
+
+Mat4 mat4_identity(void) {
+    Mat4 m = {{ 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 }};
+    return m;
+}
+
+Mat4 mat4_rotation(RotationPlane plane, float angle) {
+    Mat4 m = mat4_identity();
+    mat4_rotate(&m, plane, angle);
+    return m;
+}
+
+Mat4 mat4_mul(const Mat4* a, const Mat4* b) {
+    Mat4 r;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            r.m[4*i + j] = a->m[4*i + 0] * b->m[0 + j] + a->m[4*i + 1] * b->m[4 + j]
+                         + a->m[4*i + 2] * b->m[8 + j] + a->m[4*i + 3] * b->m[12 + j];
+        }
+    }
+    return r;
+}
+
+void mat4_rotate(Mat4* m, RotationPlane plane, float angle) {
+    int a = plane_axes[plane][0], b = plane_axes[plane][1];
+    float c = cosf(angle), s = sinf(angle);
+    // Only rows a and b change
+    for (int j = 0; j < 4; j++) {
+        float ma = m->m[4*a + j], mb = m->m[4*b + j];
+        m->m[4*a + j] = ma * c - mb * s;
+        m->m[4*b + j] = ma * s + mb * c;
+    }
+}
+
+Vertex mat4_apply(const Mat4* m, Vertex v) {
+    const float* r = m->m;
+    Vertex o;
+    o.x = r[0]  * v.x + r[1]  * v.y + r[2]  * v.z + r[3]  * v.w;
+    o.y = r[4]  * v.x + r[5]  * v.y + r[6]  * v.z + r[7]  * v.w;
+    o.z = r[8]  * v.x + r[9]  * v.y + r[10] * v.z + r[11] * v.w;
+    o.w = r[12] * v.x + r[13] * v.y + r[14] * v.z + r[15] * v.w;
+    return o;
+}
+
+Mat4 view_transform(int is_4d, float angle_x, float angle_y, float angle_xw, float angle_yw, float angle_zw) {
+    Mat4 m = mat4_identity();
+    if (is_4d) {
+        mat4_rotate(&m, PLANE_XW, angle_xw);
+        mat4_rotate(&m, PLANE_YW, angle_yw);
+        mat4_rotate(&m, PLANE_ZW, angle_zw);
+    }
+    // Rotate around X axis
+    mat4_rotate(&m, PLANE_YZ, angle_x);
+    // Rotate around Y axis, which turns z towards x
+    mat4_rotate(&m, PLANE_XZ, -angle_y);
+    return m;
+}
+
+void project_vertices(const Mat4* m, const Projection* proj, int is_4d, const Vertex* in, int count, float* out) {
+    // Local copies, out could alias m or proj as far as the compiler knows
+    const Mat4 r = *m;
+    const Projection pr = *proj;
+    for (int i = 0; i < count; i++) {
+        Vertex v = mat4_apply(&r, in[i]);
+
+        // 4D -> 3D perspective
+        if (is_4d) {
+            float w_factor = 1.0f / (pr.w_distance - v.w * pr.w_scale);
+            v.x *= w_factor;
+            v.y *= w_factor;
+            v.z *= w_factor;
+        }
+
+        // 3D perspective projection (ignoring z)
+        float factor = pr.focal / (pr.distance - v.z * pr.z_scale);
+        out[2*i] = v.x * factor;
+        out[2*i+1] = v.y * factor;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef MATH4D_H
+#define MATH4D_H
+
+#include "shapes.h"
+
+// 4D Math
+// Row-major 4x4 matrices acting on column vectors (x, y, z, w).
+// Rotations are composed once per frame, then each vertex costs one matrix-vector product.
+
+typedef struct {
+    float m[16];
+} Mat4;
+
+// The six planes a 4D rotation can act in. Rotating in plane (a, b) by angle t maps
+// a' = a cos t - b sin t, b' = a sin t + b cos t
+typedef enum {
+    PLANE_XY,
+    PLANE_XZ,
+    PLANE_XW,
+    PLANE_YZ,
+    PLANE_YW,
+    PLANE_ZW
+} RotationPlane;
+
+// Perspective divides taking a rotated vertex down to normalized device coordinates
+typedef struct {
+    float w_distance, w_scale;	// 4D -> 3D: xyz *= 1 / (w_distance - w * w_scale)
+    float distance, z_scale;	// 3D -> 2D: xy *= focal / (distance - z * z_scale)
+    float focal;
+} Projection;
+
+// The projection the viewer has always used
+extern const Projection default_projection;
+
+Mat4 mat4_identity(void);
+Mat4 mat4_rotation(RotationPlane plane, float angle);
+// a * b, i.e. b is applied first
+Mat4 mat4_mul(const Mat4* a, const Mat4* b);
+// Apply a further rotation after m (m = R * m), cheaper than building R and multiplying
+void mat4_rotate(Mat4* m, RotationPlane plane, float angle);
+Vertex mat4_apply(const Mat4* m, Vertex v);
+
+// Full viewer transform: xw, yw, zw rotations (4D shapes only), then around X, then around Y
+Mat4 view_transform(int is_4d, float angle_x, float angle_y, float angle_xw, float angle_yw, float angle_zw);
+
+// Transform and project count vertices to interleaved x, y pairs in out
+void project_vertices(const Mat4* m, const Projection* proj, int is_4d, const Vertex* in, int count, float* out);
+
+#endif
@@ -0,0 +1,100 @@
+#include "mathnd.h"
+#include <math.h>
+#include <string.h>
+
+MatN matn_identity(int n) {
+    MatN m;
+    memset(&m, 0, sizeof(m));
+    m.n = n;
+    for (int i = 0; i < n; i++) m.m[i * n + i] = 1.0f;
+    return m;
+}
+
+void matn_rotate(MatN* m, int a, int b, float angle) {
+    int n = m->n;
+    float c = cosf(angle), s = sinf(angle);
+    // Only rows a and b change
+    for (int j = 0; j < n; j++) {
+        float ma = m->m[n*a + j], mb = m->m[n*b + j];
+        m->m[n*a + j] = ma * c - mb * s;
+        m->m[n*b + j] = ma * s + mb * c;
+    }
+}
+
+MatN view_transform_n(int n, float angle_x, float angle_y, float angle_xw, float angle_yw, float angle_zw) {
+    MatN m = matn_identity(n);
+    for (int k = 3; k < n; k++) {
+        float rate = 1.0f / (k - 2);
+        matn_rotate(&m, 0, k, angle_xw * rate);
+        matn_rotate(&m, 1, k, angle_yw * rate);
+        matn_rotate(&m, 2, k, angle_zw * rate);
+    }
+    // Rotate around X axis
+    matn_rotate(&m, 1, 2, angle_x);
+    // Rotate around Y axis, which turns z towards x
+    matn_rotate(&m, 0, 2, -angle_y);
+    return m;
+}
+
+// One kernel per dimension and target, N is a constant so the loops unroll and v stays in registers.
+// The divides down the axes only build up one scale, a coordinate is scaled once when it is next needed.
+// Products are summed left to right like mat4_apply, so 3D and 4D match project_vertices() exactly
+#define DEFINE_PROJECT_KERNELS(N)                                                                           \
+static inline float project_##N##_rotate(const float* m, const Projection* pr, const float* in, float* v) {  \
+    for (int r = 0; r < N; r++) {                                                                           \
+        float sum = m[r*N] * in[0];                                                                         \
+        for (int k = 1; k < N; k++) sum += m[r*N + k] * in[k];                                              \
+        v[r] = sum;                                                                                         \
+    }                                                                                                       \
+    float scale = 1.0f;                                                                                     \
+    for (int k = N - 1; k >= 4; k--) scale *= pr->w_distance / (pr->w_distance - v[k] * scale * pr->w_scale); \
+    return scale;                                                                                           \
+}                                                                                                           \
+static void project_##N##_to_2d(const float* m, const Projection* proj, const float* in, int count, float* out) { \
+    const Projection pr = *proj;                                                                            \
+    for (int i = 0; i < count; i++, in += N) {                                                              \
+        float v[N > 4 ? N : 4] = { 0.0f };                                                                  \
+        float scale = project_##N##_rotate(m, &pr, in, v);                                                  \
+        if (N >= 4) scale *= 1.0f / (pr.w_distance - v[3] * scale * pr.w_scale);                            \
+        float factor = pr.focal / (pr.distance - v[2] * scale * pr.z_scale);                                \
+        out[2*i] = v[0] * scale * factor;                                                                   \
+        out[2*i+1] = v[1] * scale * factor;                                                                 \
+    }                                                                                                       \
+}                                                                                                           \
+static void project_##N##_to_4d(const float* m, const Projection* proj, const float* in, int count, Vertex* out) { \
+    const Projection pr = *proj;                                                                            \
+    for (int i = 0; i < count; i++, in += N) {                                                              \
+        float v[N > 4 ? N : 4] = { 0.0f };                                                                  \
+        float scale = project_##N##_rotate(m, &pr, in, v);                                                  \
+        out[i] = (Vertex){ v[0] * scale, v[1] * scale, v[2] * scale, v[3] * scale };                        \
+    }                                                                                                       \
+}
+
+DEFINE_PROJECT_KERNELS(3)
+DEFINE_PROJECT_KERNELS(4)
+DEFINE_PROJECT_KERNELS(5)
+DEFINE_PROJECT_KERNELS(6)
+DEFINE_PROJECT_KERNELS(7)
+DEFINE_PROJECT_KERNELS(8)
+
+typedef void (*Project2dKernel)(const float* m, const Projection* proj, const float* in, int count, float* out);
+typedef void (*Project4dKernel)(const float* m, const Projection* proj, const float* in, int count, Vertex* out);
+
+// Indexed by dimension
+static const Project2dKernel kernels_2d[POLY_MAX_DIM + 1] = {
+    NULL, NULL, NULL, project_3_to_2d, project_4_to_2d, project_5_to_2d, project_6_to_2d, project_7_to_2d, project_8_to_2d
+};
+static const Project4dKernel kernels_4d[POLY_MAX_DIM + 1] = {
+    NULL, NULL, NULL, project_3_to_4d, project_4_to_4d, project_5_to_4d, project_6_to_4d, project_7_to_4d, project_8_to_4d
+};
+
+void project_vertices_n(const MatN* m, const Projection* proj, const float* in, int count, float* out) {
+    // Local copy, out could alias m as far as the compiler knows
+    const MatN r = *m;
+    kernels_2d[r.n](r.m, proj, in, count, out);
+}
+
+void project_vertices_n_to_4d(const MatN* m, const Projection* proj, const float* in, int count, Vertex* out) {
+    const MatN r = *m;
+    kernels_4d[r.n](r.m, proj, in, count, out);
+}
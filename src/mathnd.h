@@ -0,0 +1,32 @@
+#ifndef MATHND_H
+#define MATHND_H
+
+#include "math4d.h"
+
+// N-Dimensional Math
+// The same scheme as math4d.h for shapes of up to POLY_MAX_DIM dimensions: rotations in any plane (a, b)
+// composed into one n x n matrix per frame, then one matrix-vector product per vertex. Projection divides
+// by each axis in turn from the last down to w, then finishes like 4D, so a 4D shape projects exactly
+// as project_vertices() does. Axes above w divide by (w_distance - c * w_scale) / w_distance, which leaves
+// points at c = 0 where they are, so a shape doesn't shrink with every dimension it has.
+// Kernels are compiled separately for every dimension from 3 to POLY_MAX_DIM.
+
+typedef struct {
+    int n;
+    float m[POLY_MAX_DIM * POLY_MAX_DIM];	// Row-major n x n, row stride n
+} MatN;
+
+MatN matn_identity(int n);
+// Apply a rotation in plane (a, b) after m (m = R * m), a' = a cos t - b sin t, b' = a sin t + b cos t
+void matn_rotate(MatN* m, int a, int b, float angle);
+
+// view_transform() generalised: every axis from w up turns against x, y and z by the xw, yw and zw angles,
+// further axes more slowly so they don't move in lockstep, then around X and Y. Equal to view_transform() for n <= 4
+MatN view_transform_n(int n, float angle_x, float angle_y, float angle_xw, float angle_yw, float angle_zw);
+
+// Transform count packed vertices of m->n floats each and project them to interleaved x, y pairs
+void project_vertices_n(const MatN* m, const Projection* proj, const float* in, int count, float* out);
+// The same, stopping after the divide by w: the 4D shadow of each vertex, for the vertex shader to finish
+void project_vertices_n_to_4d(const MatN* m, const Projection* proj, const float* in, int count, Vertex* out);
+
+#endif
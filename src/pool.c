@@ -0,0 +1,177 @@
+#include "pool.h"
+#include <stdlib.h>
+#include "threads.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef struct {
+    PoolTask task;
+    void* arg;
+} PoolJob;
+
+struct WorkerPool {
+    pthread_t* threads;
+    int thread_count;
+
+    // Ring of queued jobs, grows when full
+    PoolJob* jobs;
+    int capacity;
+    int head;
+    int queued;
+
+    int running;		// Jobs taken off the queue but not finished yet
+    int shutdown;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+};
+
+static void* worker_main(void* data) {
+    WorkerPool* pool = data;
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->queued == 0 && !pool->shutdown) pthread_cond_wait(&pool->work_ready, &pool->lock);
+        if (pool->queued == 0 && pool->shutdown) break;
+
+        PoolJob job = pool->jobs[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->queued--;
+        pool->running++;
+        pthread_mutex_unlock(&pool->lock);
+
+        job.task(job.arg);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->running--;
+        if (pool->queued == 0 && pool->running == 0) pthread_cond_broadcast(&pool->work_done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int pool_cpu_count(void) {
+    #ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+    #else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+    #endif
+}
+
+WorkerPool* pool_create(int threads) {
+    if (threads <= 0) threads = pool_cpu_count();
+
+    WorkerPool* pool = calloc(1, sizeof(WorkerPool));
+    if (!pool) return NULL;
+    pool->capacity = 64;
+    pool->jobs = malloc(sizeof(PoolJob) * pool->capacity);
+    pool->threads = malloc(sizeof(pthread_t) * threads);
+    if (!pool->jobs || !pool->threads) {
+        free(pool->jobs);
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) break;
+        pool->thread_count++;
+    }
+    if (pool->thread_count == 0) {
+        pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void pool_submit(WorkerPool* pool, PoolTask task, void* arg) {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->queued == pool->capacity) {
+        // Unroll the ring into a bigger buffer
+        int capacity = pool->capacity * 2;
+        PoolJob* jobs = malloc(sizeof(PoolJob) * capacity);
+        if (!jobs) {
+            // Out of memory, run it inline rather than drop it
+            pthread_mutex_unlock(&pool->lock);
+            task(arg);
+            return;
+        }
+        for (int i = 0; i < pool->queued; i++) jobs[i] = pool->jobs[(pool->head + i) % pool->capacity];
+        free(pool->jobs);
+        pool->jobs = jobs;
+        pool->capacity = capacity;
+        pool->head = 0;
+    }
+    pool->jobs[(pool->head + pool->queued) % pool->capacity] = (PoolJob){ task, arg };
+    pool->queued++;
+    pthread_cond_signal(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_wait(WorkerPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->queued > 0 || pool->running > 0) pthread_cond_wait(&pool->work_done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_destroy(WorkerPool* pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->thread_count; i++) pthread_join(pool->threads[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+    free(pool->threads);
+    free(pool->jobs);
+    free(pool);
+}
+
+int pool_thread_count(const WorkerPool* pool) {
+    return pool->thread_count;
+}
+
+typedef struct {
+    RangeTask task;
+    void* ctx;
+    int count;
+    int grain;
+    int next;			// Start of the next unclaimed chunk, claimed atomically
+} ParallelFor;
+
+static void parallel_for_worker(void* arg) {
+    ParallelFor* pf = arg;
+    for (;;) {
+        int start = atomic_fetch_add_int(&pf->next, pf->grain);
+        if (start >= pf->count) break;
+        int end = start + pf->grain < pf->count ? start + pf->grain : pf->count;
+        pf->task(pf->ctx, start, end);
+    }
+}
+
+void pool_parallel_for(WorkerPool* pool, int count, int grain, RangeTask task, void* ctx) {
+    if (grain <= 0) grain = 1;
+    ParallelFor pf = { task, ctx, count, grain, 0 };
+
+    // No point waking more workers than there are chunks beyond our own
+    int chunks = (count + grain - 1) / grain;
+    int helpers = pool ? pool->thread_count : 0;
+    if (helpers > chunks - 1) helpers = chunks - 1;
+    for (int i = 0; i < helpers; i++) pool_submit(pool, parallel_for_worker, &pf);
+
+    parallel_for_worker(&pf);
+    if (helpers > 0) pool_wait(pool);
+}
@@ -0,0 +1,25 @@
+#ifndef POOL_H
+#define POOL_H
+
+// Fixed set of worker threads pulling tasks off a shared queue
+
+typedef void (*PoolTask)(void* arg);
+// Processes items [start, end) of a parallel for
+typedef void (*RangeTask)(void* ctx, int start, int end);
+typedef struct WorkerPool WorkerPool;
+
+// threads <= 0 uses one worker per online core
+WorkerPool* pool_create(int threads);
+void pool_submit(WorkerPool* pool, PoolTask task, void* arg);
+// Blocks until every submitted task has finished
+void pool_wait(WorkerPool* pool);
+void pool_destroy(WorkerPool* pool);
+
+// Split [0, count) into chunks of grain items (the last may be shorter) and run them on every
+// worker plus the calling thread. Waits for the whole pool, so don't share the pool with long tasks.
+void pool_parallel_for(WorkerPool* pool, int count, int grain, RangeTask task, void* ctx);
+
+int pool_thread_count(const WorkerPool* pool);
+int pool_cpu_count(void);
+
+#endif
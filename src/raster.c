@@ -0,0 +1,246 @@
+#include "raster.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Tiles of one tile row an edge can touch, inclusive
+typedef struct {
+    int ty, tx0, tx1;
+} TileSpan;
+
+typedef struct {
+    Raster* raster;
+    const float* xy;
+    int v_count;
+    const Edge* edges;
+    int e_count;
+    int chunk_size;
+    int writing;		// 0 counts edges per tile, 1 writes them out
+} BinJob;
+
+// fminf/fmaxf are library calls unless NaNs are ruled out, these compile to single instructions
+static inline float min_f(float a, float b) {
+    return a < b ? a : b;
+}
+
+static inline float max_f(float a, float b) {
+    return a > b ? a : b;
+}
+
+int raster_init(Raster* raster, int width, int height, WorkerPool* pool) {
+    memset(raster, 0, sizeof(*raster));
+    raster->width = width;
+    raster->height = height;
+    raster->tiles_x = (width + RASTER_TILE - 1) / RASTER_TILE;
+    raster->tiles_y = (height + RASTER_TILE - 1) / RASTER_TILE;
+    raster->line_width = 2.0f;
+    raster->pool = pool;
+
+    int tiles = raster->tiles_x * raster->tiles_y;
+    raster->pixels = malloc((size_t)width * height * 4);
+    raster->chunk_counts = malloc(sizeof(int) * RASTER_BIN_CHUNKS * tiles);
+    raster->tile_start = malloc(sizeof(int) * (tiles + 1));
+    raster->spans = malloc(sizeof(TileSpan) * RASTER_BIN_CHUNKS * raster->tiles_y);
+    if (!raster->pixels || !raster->chunk_counts || !raster->tile_start || !raster->spans) {
+        raster_destroy(raster);
+        return 0;
+    }
+    return 1;
+}
+
+void raster_destroy(Raster* raster) {
+    free(raster->pixels);
+    free(raster->chunk_counts);
+    free(raster->tile_start);
+    free(raster->spans);
+    free(raster->binned);
+    memset(raster, 0, sizeof(*raster));
+}
+
+// Edge endpoints in pixels, y down. 0 if the edge can't be drawn
+static int edge_points(const Raster* raster, const float* xy, int v_count, Edge edge, float p[4]) {
+    if ((unsigned)edge.start >= (unsigned)v_count || (unsigned)edge.end >= (unsigned)v_count) return 0;
+    p[0] = (xy[2*edge.start] + 1.0f) * 0.5f * raster->width;
+    p[1] = (1.0f - xy[2*edge.start + 1]) * 0.5f * raster->height;
+    p[2] = (xy[2*edge.end] + 1.0f) * 0.5f * raster->width;
+    p[3] = (1.0f - xy[2*edge.end + 1]) * 0.5f * raster->height;
+    // Vertices behind the projection centre blow up to inf/nan
+    return isfinite(p[0]) && isfinite(p[1]) && isfinite(p[2]) && isfinite(p[3]);
+}
+
+// Tiles within reach of the segment, one span per tile row. Exact per row: a pixel within reach of
+// a point q on the segment has q inside its row's band widened by reach, and lies within reach of q.x
+static int edge_spans(const Raster* raster, const float p[4], float reach, TileSpan* spans) {
+    const float tile = (float)RASTER_TILE;
+    float min_y = max_f(min_f(p[1], p[3]) - reach, 0.0f);
+    float max_y = min_f(max_f(p[1], p[3]) + reach, raster->height - 1.0f);
+    if (min_y > max_y) return 0;
+
+    int count = 0;
+    float dx = p[2] - p[0], dy = p[3] - p[1];
+    for (int ty = (int)(min_y / tile); ty <= (int)(max_y / tile); ty++) {
+        float x_a = p[0], x_b = p[2];
+        if (dy != 0.0f) {
+            float t_a = (ty * tile - reach - p[1]) / dy;
+            float t_b = ((ty + 1) * tile + reach - p[1]) / dy;
+            if (t_a > t_b) {
+                float swap = t_a;
+                t_a = t_b;
+                t_b = swap;
+            }
+            t_a = max_f(t_a, 0.0f);
+            t_b = min_f(t_b, 1.0f);
+            if (t_a > t_b) continue;
+            x_a = p[0] + t_a * dx;
+            x_b = p[0] + t_b * dx;
+        }
+        float lo = max_f(min_f(x_a, x_b) - reach, 0.0f);
+        float hi = min_f(max_f(x_a, x_b) + reach, raster->width - 1.0f);
+        if (lo > hi) continue;
+        spans[count++] = (TileSpan){ ty, (int)(lo / tile), (int)(hi / tile) };
+    }
+    return count;
+}
+
+static void bin_range(void* ctx, int start, int end) {
+    BinJob* job = ctx;
+    Raster* raster = job->raster;
+    int tiles = raster->tiles_x * raster->tiles_y;
+    float reach = raster->line_width * 0.5f + 0.5f;
+    for (int chunk = start; chunk < end; chunk++) {
+        TileSpan* spans = (TileSpan*)raster->spans + chunk * raster->tiles_y;
+        int* counts = &raster->chunk_counts[chunk * tiles];
+        if (!job->writing) memset(counts, 0, sizeof(int) * tiles);
+        int first = chunk * job->chunk_size;
+        int last = first + job->chunk_size < job->e_count ? first + job->chunk_size : job->e_count;
+
+        for (int e = first; e < last; e++) {
+            float p[4];
+            if (!edge_points(raster, job->xy, job->v_count, job->edges[e], p)) continue;
+            int span_count = edge_spans(raster, p, reach, spans);
+            for (int s = 0; s < span_count; s++) {
+                int* row = &counts[spans[s].ty * raster->tiles_x];
+                for (int tx = spans[s].tx0; tx <= spans[s].tx1; tx++) {
+                    if (job->writing) raster->binned[row[tx]++] = e;
+                    else row[tx]++;
+                }
+            }
+        }
+    }
+}
+
+// Anti-aliased segment clipped to the tile [x0, x1) x [y0, y1), coverage falling off linearly with the
+// distance of each pixel centre from the segment. Walks the major axis one pixel at a time and only
+// visits the minor-axis pixels within reach of the line
+static void draw_segment(Raster* raster, const float p[4], int x0, int y0, int x1, int y1) {
+    float reach = raster->line_width * 0.5f + 0.5f;
+    float dx = p[2] - p[0], dy = p[3] - p[1];
+    float len2 = dx*dx + dy*dy;
+    float inv_len2 = len2 > 0.0f ? 1.0f / len2 : 0.0f;
+
+    // u is the major axis, v the minor one, strides are in bytes
+    int transpose = fabsf(dy) > fabsf(dx);
+    float au = transpose ? p[1] : p[0], av = transpose ? p[0] : p[1];
+    float du = transpose ? dy : dx, dv = transpose ? dx : dy;
+    int u0 = transpose ? y0 : x0, u1 = transpose ? y1 : x1;
+    int v0 = transpose ? x0 : y0, v1 = transpose ? x1 : y1;
+    size_t row = (size_t)raster->width * 4;
+    size_t u_stride = transpose ? row : 4, v_stride = transpose ? 4 : row;
+    float inv_du = du != 0.0f ? 1.0f / du : 0.0f;
+    float slope = dv * inv_du;
+    // Perpendicular distance per pixel of minor-axis offset, and the minor-axis reach of the line
+    float perp = len2 > 0.0f ? fabsf(du) * sqrtf(inv_len2) : 1.0f;
+    float minor_reach = reach / perp;
+    float u_min = min_f(au, au + du), u_max = max_f(au, au + du);
+
+    float lo = max_f(u_min - reach, (float)u0);
+    float hi = min_f(u_max + reach, u1 - 1.0f);
+    if (lo > hi) return;
+    for (int u = (int)lo; u <= (int)hi; u++) {
+        float cu = u + 0.5f;
+        // Away from the ends the nearest point of the segment is straight across the line
+        int interior = cu - u_min >= reach * 2.0f && u_max - cu >= reach * 2.0f;
+        float line_v = interior ? av + (cu - au) * slope : av + min_f(max_f((cu - au) * inv_du, 0.0f), 1.0f) * dv;
+
+        // Pixel centres v + 0.5 within minor_reach of the line
+        float v_lo = max_f(line_v - minor_reach - 0.5f, (float)v0);
+        float v_hi = min_f(line_v + minor_reach - 0.5f, v1 - 1.0f);
+        if (v_lo > v_hi) continue;
+        int v_first = (int)v_lo;
+        if (v_first < v_lo) v_first++;
+        unsigned char* pixel = raster->pixels + u * u_stride + v_first * v_stride;
+        for (int v = v_first; v <= (int)v_hi; v++, pixel += v_stride) {
+            float cv = v + 0.5f, distance;
+            if (interior) {
+                distance = fabsf(cv - line_v) * perp;
+            }
+            else {
+                float s = ((cu - au) * du + (cv - av) * dv) * inv_len2;
+                s = min_f(max_f(s, 0.0f), 1.0f);
+                float ou = cu - (au + s * du), ov = cv - (av + s * dv);
+                distance = sqrtf(ou*ou + ov*ov);
+            }
+            // Branch free, about half the visited pixels get no coverage. Keep the brighter line
+            float coverage = min_f(max_f(reach - distance, 0.0f), 1.0f);
+            unsigned char value = (unsigned char)(coverage * 255.0f + 0.5f);
+            value = value > pixel[0] ? value : pixel[0];
+            pixel[0] = pixel[1] = pixel[2] = value;
+        }
+    }
+}
+
+static void draw_tiles(void* ctx, int start, int end) {
+    BinJob* job = ctx;
+    Raster* raster = job->raster;
+    for (int tile = start; tile < end; tile++) {
+        int x0 = (tile % raster->tiles_x) * RASTER_TILE, y0 = (tile / raster->tiles_x) * RASTER_TILE;
+        int x1 = x0 + RASTER_TILE < raster->width ? x0 + RASTER_TILE : raster->width;
+        int y1 = y0 + RASTER_TILE < raster->height ? y0 + RASTER_TILE : raster->height;
+
+        // Black, opaque
+        for (int y = y0; y < y1; y++) {
+            unsigned char* row = &raster->pixels[((size_t)y * raster->width + x0) * 4];
+            for (int x = 0; x < x1 - x0; x++) {
+                row[x*4 + 0] = row[x*4 + 1] = row[x*4 + 2] = 0;
+                row[x*4 + 3] = 255;
+            }
+        }
+
+        for (int i = raster->tile_start[tile]; i < raster->tile_start[tile + 1]; i++) {
+            float p[4];
+            edge_points(raster, job->xy, job->v_count, job->edges[raster->binned[i]], p);
+            draw_segment(raster, p, x0, y0, x1, y1);
+        }
+    }
+}
+
+int raster_draw(Raster* raster, const float* xy, int v_count, const Edge* edges, int e_count) {
+    int tiles = raster->tiles_x * raster->tiles_y;
+    int chunks = e_count / 1024 + 1;
+    if (chunks > RASTER_BIN_CHUNKS) chunks = RASTER_BIN_CHUNKS;
+    BinJob job = { raster, xy, v_count, edges, e_count, (e_count + chunks - 1) / chunks, 0 };
+
+    // Count, then turn the counts into each chunk's write position within each tile
+    pool_parallel_for(raster->pool, chunks, 1, bin_range, &job);
+    size_t total = 0;
+    for (int t = 0; t < tiles; t++) {
+        raster->tile_start[t] = (int)total;
+        for (int c = 0; c < chunks; c++) {
+            int count = raster->chunk_counts[c * tiles + t];
+            raster->chunk_counts[c * tiles + t] = (int)total;
+            total += count;
+        }
+    }
+    raster->tile_start[tiles] = (int)total;
+    if (total > raster->binned_capacity) {
+        int* binned = realloc(raster->binned, sizeof(int) * total);
+        if (!binned) return 0;
+        raster->binned = binned;
+        raster->binned_capacity = total;
+    }
+    job.writing = 1;
+    pool_parallel_for(raster->pool, chunks, 1, bin_range, &job);
+
+    pool_parallel_for(raster->pool, tiles, 1, draw_tiles, &job);
+    return 1;
+}
@@ -0,0 +1,39 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "shapes.h"
+#include "pool.h"
+
+// Software Line Rasterizer
+// Draws projected edges into an RGBA image without any GL driver.
+// Edges are first binned into RASTER_TILE square screen tiles (in parallel over chunks of edges),
+// then every tile is cleared and drawn by one thread, so no two threads ever touch the same pixel.
+// Lines are anti-aliased by their distance to each pixel centre and combined with max(),
+// which makes the image independent of edge and thread order.
+
+#define RASTER_TILE 64
+// Edge chunks binned in parallel, each with its own per-tile counts
+#define RASTER_BIN_CHUNKS 64
+
+typedef struct {
+    int width, height;
+    int tiles_x, tiles_y;
+    unsigned char* pixels;	// RGBA, top row first
+    float line_width;		// In pixels, 2 like the GL path
+    WorkerPool* pool;		// NULL draws on the calling thread
+    int* chunk_counts;		// RASTER_BIN_CHUNKS x tiles, then turned into write offsets
+    int* tile_start;		// Where each tile's edges start in binned, tiles + 1 entries
+    int* binned;			// Edge indices grouped by tile
+    void* spans;			// Scratch per bin chunk
+    size_t binned_capacity;
+} Raster;
+
+// 0 if out of memory
+int raster_init(Raster* raster, int width, int height, WorkerPool* pool);
+void raster_destroy(Raster* raster);
+
+// Clear to black and draw edges between xy (two floats per vertex, NDC as transform_shape() writes them)
+// in white. Returns 0 if out of memory
+int raster_draw(Raster* raster, const float* xy, int v_count, const Edge* edges, int e_count);
+
+#endif
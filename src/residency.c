@@ -0,0 +1,262 @@
+#include "residency.h"
+#include <stdlib.h>
+#include <string.h>
+#include "timer.h"
+
+// Vertex offsets are multiples of the vertex size so they convert to a base vertex,
+// index offsets stay aligned for the widest index type
+#define INDEX_ALIGN 4
+
+static size_t round_up(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+}
+
+static void arena_reset(Arena* arena, size_t capacity) {
+    arena->capacity = capacity;
+    arena->free_count = 0;
+    if (capacity == 0) return;
+    if (arena->free_capacity == 0) {
+        arena->free_capacity = 16;
+        arena->free = malloc(sizeof(ArenaBlock) * arena->free_capacity);
+    }
+    arena->free[0] = (ArenaBlock){ 0, capacity };
+    arena->free_count = 1;
+}
+
+static int arena_alloc(Arena* arena, size_t size, size_t* offset) {
+    if (size == 0) {
+        *offset = 0;
+        return 1;
+    }
+    for (int i = 0; i < arena->free_count; i++) {
+        ArenaBlock* block = &arena->free[i];
+        if (block->size < size) continue;
+        *offset = block->offset;
+        block->offset += size;
+        block->size -= size;
+        if (block->size == 0) {
+            memmove(block, block + 1, sizeof(ArenaBlock) * (arena->free_count - i - 1));
+            arena->free_count--;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static void arena_free(Arena* arena, size_t offset, size_t size) {
+    if (size == 0) return;
+
+    // Insertion point keeping the list sorted
+    int i = 0;
+    while (i < arena->free_count && arena->free[i].offset < offset) i++;
+
+    int joins_prev = i > 0 && arena->free[i-1].offset + arena->free[i-1].size == offset;
+    int joins_next = i < arena->free_count && offset + size == arena->free[i].offset;
+    if (joins_prev && joins_next) {
+        arena->free[i-1].size += size + arena->free[i].size;
+        memmove(&arena->free[i], &arena->free[i+1], sizeof(ArenaBlock) * (arena->free_count - i - 1));
+        arena->free_count--;
+    } else if (joins_prev) {
+        arena->free[i-1].size += size;
+    } else if (joins_next) {
+        arena->free[i].offset = offset;
+        arena->free[i].size += size;
+    } else {
+        if (arena->free_count == arena->free_capacity) {
+            arena->free_capacity = arena->free_capacity ? arena->free_capacity * 2 : 16;
+            arena->free = realloc(arena->free, sizeof(ArenaBlock) * arena->free_capacity);
+        }
+        memmove(&arena->free[i+1], &arena->free[i], sizeof(ArenaBlock) * (arena->free_count - i));
+        arena->free[i] = (ArenaBlock){ offset, size };
+        arena->free_count++;
+    }
+}
+
+// (Re)create the storage behind the shared buffers, contents are lost
+static void allocate_buffers(Residency* res, size_t vertex_capacity, size_t index_capacity) {
+    glBindVertexArray(res->vao);
+    if (res->mode == RESIDENCY_SOURCE) {
+        glBindBuffer(GL_ARRAY_BUFFER, res->vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertex_capacity, NULL, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, res->ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_capacity, NULL, GL_STATIC_DRAW);
+    arena_reset(&res->vertices, vertex_capacity);
+    arena_reset(&res->indices, index_capacity);
+}
+
+void residency_init(Residency* res, int count, size_t vertex_capacity, size_t index_capacity,
+                    ResidencyMode mode, GLuint projected_buffer) {
+    memset(res, 0, sizeof(*res));
+    res->shapes = calloc(count, sizeof(GpuShape));
+    res->count = count;
+    res->mode = mode;
+    res->projected_buffer = projected_buffer;
+
+    glGenVertexArrays(1, &res->vao);
+    glGenBuffers(1, &res->ebo);
+    if (mode == RESIDENCY_SOURCE) glGenBuffers(1, &res->vbo);
+    allocate_buffers(res, round_up(vertex_capacity, sizeof(Vertex)), round_up(index_capacity, INDEX_ALIGN));
+
+    glBindVertexArray(res->vao);
+    if (mode == RESIDENCY_SOURCE) {
+        // The shapes as loaded, one vec4 per vertex
+        glBindBuffer(GL_ARRAY_BUFFER, res->vbo);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    } else {
+        // Positions come from the shared stream, the draw's base vertex picks the frame's region
+        glBindBuffer(GL_ARRAY_BUFFER, projected_buffer);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), (void*)0);
+    }
+    glEnableVertexAttribArray(0);
+}
+
+void residency_destroy(Residency* res) {
+    glDeleteVertexArrays(1, &res->vao);
+    if (res->vbo) glDeleteBuffers(1, &res->vbo);
+    glDeleteBuffers(1, &res->ebo);
+    free(res->vertices.free);
+    free(res->indices.free);
+    free(res->shapes);
+    memset(res, 0, sizeof(*res));
+}
+
+void residency_set_projected_buffer(Residency* res, GLuint buffer) {
+    res->projected_buffer = buffer;
+    glBindVertexArray(res->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2*sizeof(float), (void*)0);
+}
+
+size_t residency_vertex_bytes(ResidencyMode mode, const Polyhedron* shape) {
+    return mode == RESIDENCY_SOURCE ? shape->v_count * sizeof(Vertex) : 0;
+}
+
+size_t residency_index_size(int v_count) {
+    if (v_count <= 0x100) return 1;
+    if (v_count <= 0x10000) return 2;
+    return 4;
+}
+
+size_t residency_index_bytes(const Polyhedron* shape) {
+    return round_up(shape->e_count * 2 * residency_index_size(shape->v_count), INDEX_ALIGN);
+}
+
+static GLenum index_type(size_t size) {
+    return size == 1 ? GL_UNSIGNED_BYTE : size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+// Copy one shape into its ranges of the shared buffers
+static void upload(const Residency* res, const GpuShape* g, const Polyhedron* shape) {
+    if (g->vertex_bytes) {
+        glBindBuffer(GL_ARRAY_BUFFER, res->vbo);
+        if (shape->vertices) {
+            glBufferSubData(GL_ARRAY_BUFFER, g->vertex_offset, g->vertex_bytes, shape->vertices);
+        } else {
+            // SoA shapes get interleaved once for the upload
+            Vertex* packed = malloc(g->vertex_bytes);
+            for (int i = 0; packed && i < shape->v_count; i++) packed[i] = shape_vertex(shape, i);
+            if (packed) glBufferSubData(GL_ARRAY_BUFFER, g->vertex_offset, g->vertex_bytes, packed);
+            free(packed);
+        }
+    }
+    if (g->index_bytes) {
+        // The element binding is VAO state, the VAO is always bound.
+        // Edge is two packed ints so 32-bit indices upload as-is, narrower ones are packed down
+        size_t count = (size_t)shape->e_count * 2;
+        const unsigned int* wide = (const unsigned int*)shape->edges;
+        if (g->index_type == GL_UNSIGNED_INT) {
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, g->index_offset, count * 4, wide);
+        } else if (g->index_type == GL_UNSIGNED_SHORT) {
+            GLushort* packed = malloc(count * sizeof(GLushort));
+            for (size_t i = 0; packed && i < count; i++) packed[i] = (GLushort)wide[i];
+            if (packed) glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, g->index_offset, count * sizeof(GLushort), packed);
+            free(packed);
+        } else {
+            GLubyte* packed = malloc(count);
+            for (size_t i = 0; packed && i < count; i++) packed[i] = (GLubyte)wide[i];
+            if (packed) glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, g->index_offset, count, packed);
+            free(packed);
+        }
+    }
+}
+
+static int any_resident(const Residency* res) {
+    for (int i = 0; i < res->count; i++) {
+        if (res->shapes[i].resident) return 1;
+    }
+    return 0;
+}
+
+GpuShape* residency_acquire(Residency* res, int idx, const Polyhedron* shape) {
+    GpuShape* g = &res->shapes[idx];
+    if (!g->resident) {
+        size_t vertex_bytes = residency_vertex_bytes(res->mode, shape);
+        size_t index_bytes = residency_index_bytes(shape);
+
+        // Alone and still too big: grow, nothing needs preserving
+        if (!any_resident(res) && (vertex_bytes > res->vertices.capacity || index_bytes > res->indices.capacity)) {
+            allocate_buffers(res, vertex_bytes > res->vertices.capacity ? vertex_bytes : res->vertices.capacity,
+                             index_bytes > res->indices.capacity ? index_bytes : res->indices.capacity);
+        }
+
+        size_t vertex_offset, index_offset;
+        if (!arena_alloc(&res->vertices, vertex_bytes, &vertex_offset)) return NULL;
+        if (!arena_alloc(&res->indices, index_bytes, &index_offset)) {
+            arena_free(&res->vertices, vertex_offset, vertex_bytes);
+            return NULL;
+        }
+
+        g->vertex_offset = vertex_offset;
+        g->vertex_bytes = vertex_bytes;
+        g->index_offset = index_offset;
+        g->index_bytes = index_bytes;
+        g->index_count = shape->e_count * 2;
+        g->index_type = index_type(residency_index_size(shape->v_count));
+        g->base_vertex = (GLint)(vertex_offset / sizeof(Vertex));
+        g->resident = 1;
+        upload(res, g, shape);
+    }
+    g->last_used = ++res->tick;
+    return g;
+}
+
+void residency_update(const Residency* res, int idx, const Vertex* vertices) {
+    const GpuShape* g = &res->shapes[idx];
+    if (!g->resident || !g->vertex_bytes) return;
+    glBindBuffer(GL_ARRAY_BUFFER, res->vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, g->vertex_offset, g->vertex_bytes, vertices);
+}
+
+void residency_update_shadow(const Residency* res, int idx, const Polyhedron* shape, WorkerPool* pool,
+                             const MatN* m, const Projection* proj, Vertex* shadow,
+                             double* transform_seconds, double* upload_seconds) {
+    double transform_start = timer_now();
+    transform_shape_n_to_4d(pool, m, proj, shape, shadow);
+    double upload_start = timer_now();
+    residency_update(res, idx, shadow);
+    if (transform_seconds) *transform_seconds += upload_start - transform_start;
+    if (upload_seconds) *upload_seconds += timer_now() - upload_start;
+}
+
+void residency_evict(Residency* res, int idx) {
+    GpuShape* g = &res->shapes[idx];
+    if (!g->resident) return;
+    arena_free(&res->vertices, g->vertex_offset, g->vertex_bytes);
+    arena_free(&res->indices, g->index_offset, g->index_bytes);
+    memset(g, 0, sizeof(*g));
+}
+
+int residency_lru(const Residency* res, int keep) {
+    int victim = -1;
+    for (int i = 0; i < res->count; i++) {
+        if (i == keep || !res->shapes[i].resident) continue;
+        if (victim < 0 || res->shapes[i].last_used < res->shapes[victim].last_used) victim = i;
+    }
+    return victim;
+}
+
+void residency_draw(const Residency* res, int idx, GLint base_vertex) {
+    const GpuShape* g = &res->shapes[idx];
+    glDrawElementsBaseVertex(GL_LINES, g->index_count, g->index_type, (void*)g->index_offset, g->base_vertex + base_vertex);
+}
@@ -0,0 +1,83 @@
+#ifndef RESIDENCY_H
+#define RESIDENCY_H
+
+#include <stddef.h>
+#include <glad/glad.h>
+#include "shapes.h"
+#include "transform.h"
+
+// GPU Residency
+// Every shape lives in one shared vertex buffer and one shared index buffer behind a single VAO.
+// Shapes are placed on first use and drawn with a base vertex, so switching shapes binds nothing:
+// the VAO is bound by init and every call below leaves it bound.
+// When a shape doesn't fit, the caller evicts least-recently-used shapes until it does.
+
+// What the shared vertex buffer holds
+typedef enum {
+    RESIDENCY_SOURCE,		// Original 4D vertices, static, transformed in the vertex shader
+    RESIDENCY_PROJECTED		// Nothing, 2D positions are streamed into projected_buffer every frame
+} ResidencyMode;
+
+// First-fit free list over one GL buffer
+typedef struct {
+    size_t offset, size;
+} ArenaBlock;
+
+typedef struct {
+    size_t capacity;
+    ArenaBlock* free;		// Sorted by offset, neighbours always coalesced
+    int free_count;
+    int free_capacity;
+} Arena;
+
+typedef struct {
+    size_t vertex_offset, vertex_bytes;
+    size_t index_offset, index_bytes;
+    GLsizei index_count;
+    GLenum index_type;		// Narrowest of GL_UNSIGNED_BYTE/SHORT/INT that holds every vertex index
+    GLint base_vertex;		// RESIDENCY_SOURCE: first vertex of the shape in the shared buffer
+    unsigned long last_used;
+    int resident;
+} GpuShape;
+
+typedef struct {
+    GpuShape* shapes;
+    int count;
+    ResidencyMode mode;
+    GLuint vao, vbo, ebo;
+    GLuint projected_buffer;	// RESIDENCY_PROJECTED: the stream the VAO reads positions from
+    Arena vertices, indices;
+    unsigned long tick;		// Bumped on every acquire, orders last_used
+} Residency;
+
+// Capacities in bytes; eager callers pass the total of every shape, lazy ones their budget
+void residency_init(Residency* res, int count, size_t vertex_capacity, size_t index_capacity,
+                    ResidencyMode mode, GLuint projected_buffer);
+void residency_destroy(Residency* res);
+// Point the VAO at a new stream after it was recreated
+void residency_set_projected_buffer(Residency* res, GLuint buffer);
+
+// Bytes shape takes in each shared buffer
+size_t residency_vertex_bytes(ResidencyMode mode, const Polyhedron* shape);
+size_t residency_index_bytes(const Polyhedron* shape);
+// Bytes per index for a shape of v_count vertices, 1, 2 or 4
+size_t residency_index_size(int v_count);
+
+// Place shape idx, uploading it if it isn't resident. NULL if it doesn't fit beside the shapes already
+// resident, evict some and try again. With nothing else resident the buffers grow to fit.
+GpuShape* residency_acquire(Residency* res, int idx, const Polyhedron* shape);
+void residency_evict(Residency* res, int idx);
+// Replace the source vertices of resident shape idx, e.g. with this frame's 4D shadow of a higher dimensional shape
+void residency_update(const Residency* res, int idx, const Vertex* vertices);
+// Rotate higher dimensional shape idx by m and divide it down to 4D on pool (through shadow, v_count vertices),
+// then upload that in place of its vertices: drawn with the identity matrix, the shader only projects it.
+// Seconds spent on each half are added to transform_seconds and upload_seconds unless they're NULL
+void residency_update_shadow(const Residency* res, int idx, const Polyhedron* shape, WorkerPool* pool,
+                             const MatN* m, const Projection* proj, Vertex* shadow,
+                             double* transform_seconds, double* upload_seconds);
+// Least recently used resident shape other than keep, -1 if there is none
+int residency_lru(const Residency* res, int keep);
+// Draw shape idx (must be resident) as lines, base_vertex added to its own for streamed positions
+void residency_draw(const Residency* res, int idx, GLint base_vertex);
+
+#endif
@@ -3,42 +3,561 @@
 #include <stdlib.h>
 #include <string.h>
 
-int load_shape(const char* filename, Polyhedron* shape) {
-    FILE* file = fopen(filename, "r");
-    if (!file) return 0;
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-    // Read Name and 4D Flag
-    if (fscanf(file, "%31s %d", shape->name, &shape->is_4d) != 2) {
-        fclose(file);
-        return 0;
+// Text Parser
+// Scans the whole file image in place, no per-token stdio calls and no locale dependence.
+typedef struct {
+    const char* cur;
+    const char* end;
+    const char* line_start;
+    int line;
+    const char* filename;
+} Scanner;
+
+static int scan_error(Scanner* s, const char* what) {
+    fprintf(stderr, "%s:%d:%d: %s\n", s->filename, s->line, (int)(s->cur - s->line_start) + 1, what);
+    return 0;
+}
+
+// Skip spaces, tabs and newlines, keeping the line count up to date
+static void skip_space(Scanner* s) {
+    while (s->cur < s->end) {
+        char c = *s->cur;
+        if (c == '\n') {
+            s->line++;
+            s->line_start = s->cur + 1;
+        } else if (c != ' ' && c != '\t' && c != '\r') {
+            break;
+        }
+        s->cur++;
     }
+}
 
-    // Read Counts
-    if (fscanf(file, "%d %d", &shape->v_count, &shape->e_count) != 2) {
-        fclose(file);
-        return 0;
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static int scan_int(Scanner* s, int* out) {
+    skip_space(s);
+    const char* p = s->cur;
+    int negative = 0;
+    if (p < s->end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    if (p >= s->end || !is_digit(*p)) return scan_error(s, "expected integer");
+
+    long long value = 0;
+    while (p < s->end && is_digit(*p)) {
+        value = value * 10 + (*p++ - '0');
+        if (value > 2147483647LL) return scan_error(s, "integer out of range");
     }
+    *out = (int)(negative ? -value : value);
+    s->cur = p;
+    return 1;
+}
+
+// Vertex index, checked against the declared vertex count
+static int scan_index(Scanner* s, int* out, int v_count) {
+    skip_space(s);
+    const char* token = s->cur;
+    if (!scan_int(s, out)) return 0;
+    if (*out < 0 || *out >= v_count) {
+        s->cur = token;
+        return scan_error(s, "edge index out of range");
+    }
+    return 1;
+}
+
+// Decimal float: [+-]digits[.digits][(e|E)[+-]digits]
+// Mantissa is gathered as an integer and scaled once, exact for the short literals .shape files use.
+static int scan_float(Scanner* s, float* out) {
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    skip_space(s);
+    const char* p = s->cur;
+    int negative = 0;
+    if (p < s->end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    unsigned long long mantissa = 0;
+    int exponent = 0, digits = 0;
+    while (p < s->end && is_digit(*p)) {
+        if (mantissa < 100000000000000000ULL) mantissa = mantissa * 10 + (*p - '0');
+        else exponent++;
+        p++;
+        digits++;
+    }
+    if (p < s->end && *p == '.') {
+        p++;
+        while (p < s->end && is_digit(*p)) {
+            if (mantissa < 100000000000000000ULL) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+            p++;
+            digits++;
+        }
+    }
+    if (digits == 0) return scan_error(s, "expected number");
+
+    if (p < s->end && (*p == 'e' || *p == 'E')) {
+        p++;
+        int exp_negative = 0, exp_value = 0;
+        if (p < s->end && (*p == '-' || *p == '+')) exp_negative = *p++ == '-';
+        if (p >= s->end || !is_digit(*p)) {
+            s->cur = p;
+            return scan_error(s, "expected exponent digits");
+        }
+        while (p < s->end && is_digit(*p)) {
+            if (exp_value < 10000) exp_value = exp_value * 10 + (*p - '0');
+            p++;
+        }
+        exponent += exp_negative ? -exp_value : exp_value;
+    }
+
+    double value = (double)mantissa;
+    while (exponent > 22) { value *= 1e22; exponent -= 22; }
+    while (exponent < -22) { value /= 1e22; exponent += 22; }
+    value = exponent < 0 ? value / pow10[-exponent] : value * pow10[exponent];
+
+    *out = (float)(negative ? -value : value);
+    s->cur = p;
+    return 1;
+}
+
+// Name token, truncated to fit shape->name like the old %31s
+static int scan_name(Scanner* s, char* name, size_t size) {
+    skip_space(s);
+    size_t len = 0;
+    while (s->cur < s->end && *s->cur != ' ' && *s->cur != '\t' && *s->cur != '\r' && *s->cur != '\n') {
+        if (len + 1 < size) name[len++] = *s->cur;
+        s->cur++;
+    }
+    name[len] = '\0';
+    if (len == 0) return scan_error(s, "expected shape name");
+    return 1;
+}
+
+// Header: name, 4D flag or dimension, vertex count and optional edge count. per_vertex is the number of coordinates on each vertex line
+static int parse_header(Scanner* s, Polyhedron* shape, int* per_vertex) {
+    int dim;
+    if (!scan_name(s, shape->name, sizeof(shape->name))) return 0;
+    if (!scan_int(s, &dim)) return 0;
+    if (dim == 0 || dim == 1) {
+        // The original 3D/4D flag, always four coordinates
+        shape->is_4d = dim;
+        shape->dim = dim ? 4 : 3;
+        *per_vertex = 4;
+    }
+    else if (dim >= 3 && dim <= POLY_MAX_DIM) {
+        shape->is_4d = dim >= 4;
+        shape->dim = dim;
+        *per_vertex = dim;
+    }
+    else {
+        return scan_error(s, "expected 0, 1 or a dimension from 3 to 8");
+    }
+    if (!scan_int(s, &shape->v_count)) return 0;
+    // Vertex-only files leave out the edge count and go straight to the 'v' lines
+    skip_space(s);
+    shape->e_count = 0;
+    if (s->cur < s->end && *s->cur != 'v' && !scan_int(s, &shape->e_count)) return 0;
+    if (shape->v_count < 0 || shape->e_count < 0) return scan_error(s, "negative vertex or edge count");
+    return 1;
+}
+
+static int parse_shape_text(Scanner* s, Polyhedron* shape) {
+    int per_vertex;
+    if (!parse_header(s, shape, &per_vertex)) return 0;
 
     // Allocate memory based on counts
-    shape->vertices = (Vertex*)malloc(sizeof(Vertex) * shape->v_count);
+    if (shape->dim > 4) shape->coords = (float*)malloc(sizeof(float) * shape->dim * shape->v_count);
+    else shape->vertices = (Vertex*)malloc(sizeof(Vertex) * shape->v_count);
     shape->edges = (Edge*)malloc(sizeof(Edge) * shape->e_count);
+    if ((shape->v_count && !shape->vertices && !shape->coords) || (shape->e_count && !shape->edges)) {
+        return scan_error(s, "out of memory");
+    }
 
-    // Parse data
-    char line_type;
     int v_idx = 0, e_idx = 0;
     while (v_idx < shape->v_count || e_idx < shape->e_count) {
-        if (fscanf(file, " %c", &line_type) != 1) break;
+        skip_space(s);
+        if (s->cur >= s->end) {
+            char msg[96];
+            sprintf(msg, "unexpected end of file, read %d/%d vertices and %d/%d edges",
+                    v_idx, shape->v_count, e_idx, shape->e_count);
+            return scan_error(s, msg);
+        }
 
-        if (line_type == 'v' && v_idx < shape->v_count) {
-            fscanf(file, "%f %f %f %f", &shape->vertices[v_idx].x, &shape->vertices[v_idx].y, 
-                                        &shape->vertices[v_idx].z, &shape->vertices[v_idx].w);
+        char line_type = *s->cur;
+        if (line_type == 'v') {
+            if (v_idx == shape->v_count) return scan_error(s, "more vertices than declared");
+            s->cur++;
+            if (shape->coords) {
+                float* c = &shape->coords[(size_t)v_idx * shape->dim];
+                for (int k = 0; k < per_vertex; k++) {
+                    if (!scan_float(s, &c[k])) return 0;
+                }
+            } else {
+                Vertex* v = &shape->vertices[v_idx];
+                v->w = 0.0f;
+                if (!scan_float(s, &v->x) || !scan_float(s, &v->y) || !scan_float(s, &v->z) ||
+                    (per_vertex == 4 && !scan_float(s, &v->w))) return 0;
+            }
             v_idx++;
-        } else if (line_type == 'e' && e_idx < shape->e_count) {
-            fscanf(file, "%d %d", &shape->edges[e_idx].start, &shape->edges[e_idx].end);
+        } else if (line_type == 'e') {
+            if (e_idx == shape->e_count) return scan_error(s, "more edges than declared");
+            s->cur++;
+            Edge* e = &shape->edges[e_idx];
+            if (!scan_index(s, &e->start, shape->v_count) || !scan_index(s, &e->end, shape->v_count)) return 0;
             e_idx++;
+        } else {
+            return scan_error(s, "expected 'v' or 'e'");
+        }
+    }
+    return 1;
+}
+
+static int load_shape_text(const char* filename, Polyhedron* shape) {
+    const char* data;
+    size_t size;
+
+    #ifdef _WIN32
+    FILE* file = fopen(filename, "rb");
+    if (!file) return 0;
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (file_size < 0) {
+        fclose(file);
+        return 0;
+    }
+    size = (size_t)file_size;
+    char* buffer = malloc(size ? size : 1);
+    if (!buffer || fread(buffer, 1, size, file) != size) {
+        free(buffer);
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+    data = buffer;
+    #else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+    size = (size_t)st.st_size;
+    void* base = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (base == MAP_FAILED) return 0;
+    if (base) madvise(base, size, MADV_SEQUENTIAL);
+    data = base;
+    #endif
+
+    Scanner s = { data, data + size, data, 1, filename };
+    shape->vertices = NULL;
+    shape->coords = NULL;
+    shape->edges = NULL;
+    shape->mapping = NULL;
+    shape->mapping_size = 0;
+    memset(&shape->soa, 0, sizeof(shape->soa));
+    int ok = parse_shape_text(&s, shape);
+    if (!ok) {
+        free(shape->vertices);
+        free(shape->coords);
+        free(shape->edges);
+        shape->vertices = NULL;
+        shape->coords = NULL;
+        shape->edges = NULL;
+    }
+
+    #ifdef _WIN32
+    free(buffer);
+    #else
+    if (base) munmap(base, size);
+    #endif
+    return ok;
+}
+
+int load_shape(const char* filename, Polyhedron* shape) {
+    const char* ext = strrchr(filename, '.');
+    if (ext && strcmp(ext, ".shapeb") == 0) return load_shape_binary(filename, shape);
+    return load_shape_text(filename, shape);
+}
+
+// Dimension a binary header declares, 0 if the version or dimension isn't supported
+static int binary_dim(const ShapeBinaryHeader* header) {
+    if (header->version == 1) return header->is_4d ? 4 : 3;
+    if (header->version != SHAPEB_VERSION || header->dim < 3 || header->dim > POLY_MAX_DIM) return 0;
+    return header->dim;
+}
+
+// Bytes per vertex in the vertex array
+static uint64_t vertex_stride(int dim) {
+    return dim > 4 ? sizeof(float) * dim : sizeof(Vertex);
+}
+
+int load_shape_header(const char* filename, Polyhedron* shape) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return 0;
+
+    // Both formats keep everything needed in the first few hundred bytes
+    char buffer[512];
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+
+    shape->vertices = NULL;
+    shape->coords = NULL;
+    shape->edges = NULL;
+    shape->mapping = NULL;
+    shape->mapping_size = 0;
+    memset(&shape->soa, 0, sizeof(shape->soa));
+
+    if (size >= sizeof(ShapeBinaryHeader) && memcmp(buffer, SHAPEB_MAGIC, 4) == 0) {
+        ShapeBinaryHeader header;
+        memcpy(&header, buffer, sizeof(header));
+        int dim = binary_dim(&header);
+        if (!dim || header.v_count < 0 || header.e_count < 0) return 0;
+        memcpy(shape->name, header.name, sizeof(shape->name));
+        shape->name[sizeof(shape->name) - 1] = '\0';
+        shape->is_4d = header.is_4d;
+        shape->dim = dim;
+        shape->v_count = header.v_count;
+        shape->e_count = header.e_count;
+        return 1;
+    }
+
+    Scanner s = { buffer, buffer + size, buffer, 1, filename };
+    int per_vertex;
+    return parse_header(&s, shape, &per_vertex);
+}
+
+// Round up to the next multiple of SHAPEB_ALIGN
+static uint64_t shapeb_align(uint64_t offset) {
+    return (offset + SHAPEB_ALIGN - 1) & ~(uint64_t)(SHAPEB_ALIGN - 1);
+}
+
+// Validate the header and point the shape into the file image. The image is read-only: a shape with a
+// mapping is never edited in place, hull and edge inference refuse it
+static int bind_binary(Polyhedron* shape, const unsigned char* base, size_t size, const char* filename) {
+    if (size < sizeof(ShapeBinaryHeader)) return 0;
+
+    const ShapeBinaryHeader* header = (const ShapeBinaryHeader*)base;
+    if (memcmp(header->magic, SHAPEB_MAGIC, 4) != 0) return 0;
+    int dim = binary_dim(header);
+    if (!dim) return 0;
+    if (header->v_count < 0 || header->e_count < 0) return 0;
+
+    // Arrays must be aligned and lie entirely inside the file
+    uint64_t v_bytes = (uint64_t)header->v_count * vertex_stride(dim);
+    uint64_t e_bytes = (uint64_t)header->e_count * sizeof(Edge);
+    if (header->vertex_offset % SHAPEB_ALIGN || header->edge_offset % SHAPEB_ALIGN) return 0;
+    if (header->vertex_offset > size || v_bytes > size - header->vertex_offset) return 0;
+    if (header->edge_offset > size || e_bytes > size - header->edge_offset) return 0;
+
+    // Same range check the text scanner makes, nothing downstream looks at an index again
+    const Edge* edges = (const Edge*)(base + header->edge_offset);
+    for (int i = 0; i < header->e_count; i++) {
+        if (edges[i].start < 0 || edges[i].start >= header->v_count || edges[i].end < 0 || edges[i].end >= header->v_count) {
+            fprintf(stderr, "%s: edge %d index out of range\n", filename, i);
+            return 0;
         }
     }
 
+    memcpy(shape->name, header->name, sizeof(shape->name));
+    shape->name[sizeof(shape->name) - 1] = '\0';
+    shape->is_4d = header->is_4d;
+    shape->dim = dim;
+    shape->v_count = header->v_count;
+    shape->e_count = header->e_count;
+    const void* vertices = base + header->vertex_offset;
+    shape->vertices = dim > 4 ? NULL : (Vertex*)vertices;
+    shape->coords = dim > 4 ? (float*)vertices : NULL;
+    shape->edges = (Edge*)edges;
+    shape->mapping = (void*)base;
+    shape->mapping_size = size;
+    memset(&shape->soa, 0, sizeof(shape->soa));
+    return 1;
+}
+
+int load_shape_binary(const char* filename, Polyhedron* shape) {
+    #ifdef _WIN32
+    // No mmap here, read the whole image into one block instead
+    FILE* file = fopen(filename, "rb");
+    if (!file) return 0;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0) {
+        fclose(file);
+        return 0;
+    }
+
+    unsigned char* base = malloc(size);
+    if (!base || fread(base, 1, size, file) != (size_t)size) {
+        free(base);
+        fclose(file);
+        return 0;
+    }
     fclose(file);
+
+    if (!bind_binary(shape, base, size, filename)) {
+        free(base);
+        return 0;
+    }
+    #else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return 0;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return 0;
+    }
+
+    // Read-only, so a stray write faults instead of quietly copying the page
+    size_t size = (size_t)st.st_size;
+    void* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return 0;
+
+    if (!bind_binary(shape, base, size, filename)) {
+        munmap(base, size);
+        return 0;
+    }
+    #endif
+    return 1;
+}
+
+// Write zero bytes until the file position reaches offset
+static int pad_to(FILE* file, uint64_t offset) {
+    static const unsigned char zeros[SHAPEB_ALIGN] = {0};
+    long pos = ftell(file);
+    if (pos < 0) return 0;
+    uint64_t pad = offset - (uint64_t)pos;
+    return fwrite(zeros, 1, pad, file) == pad;
+}
+
+int save_shape_binary(const char* filename, const Polyhedron* shape) {
+    int dim = shape_dim(shape);
+    const void* vertices = dim > 4 ? (const void*)shape->coords : (const void*)shape->vertices;
+    if (!vertices && shape->v_count > 0) return 0;	// SoA shapes aren't written back
+
+    ShapeBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SHAPEB_MAGIC, 4);
+    header.version = SHAPEB_VERSION;
+    memcpy(header.name, shape->name, strnlen(shape->name, sizeof(header.name) - 1));
+    header.is_4d = shape->is_4d;
+    header.v_count = shape->v_count;
+    header.e_count = shape->e_count;
+    header.dim = dim;
+    header.vertex_offset = shapeb_align(sizeof(header));
+    header.edge_offset = shapeb_align(header.vertex_offset + (uint64_t)shape->v_count * vertex_stride(dim));
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) return 0;
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1
+          && pad_to(file, header.vertex_offset)
+          && fwrite(vertices, vertex_stride(dim), shape->v_count, file) == (size_t)shape->v_count
+          && pad_to(file, header.edge_offset)
+          && fwrite(shape->edges, sizeof(Edge), shape->e_count, file) == (size_t)shape->e_count;
+
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) remove(filename);
+    return ok;
+}
+
+void* alloc_aligned(size_t size) {
+    #ifdef _WIN32
+    return _aligned_malloc(size, SOA_ALIGN);
+    #else
+    void* p;
+    return posix_memalign(&p, SOA_ALIGN, size) == 0 ? p : NULL;
+    #endif
+}
+
+void free_aligned(void* p) {
+    #ifdef _WIN32
+    _aligned_free(p);
+    #else
+    free(p);
+    #endif
+}
+
+int shape_to_soa(Polyhedron* shape) {
+    if (shape->soa.block || !shape->vertices) return 1;
+
+    // Each component padded out to whole cache lines so every array starts aligned
+    int components = shape->is_4d ? 4 : 3;
+    size_t stride = ((sizeof(float) * shape->v_count + SOA_ALIGN - 1) / SOA_ALIGN) * SOA_ALIGN;
+    float* block = alloc_aligned(stride * components + SOA_ALIGN);
+    if (!block) return 0;
+
+    VertexSoA soa;
+    soa.block = block;
+    soa.x = block;
+    soa.y = (float*)((char*)block + stride);
+    soa.z = (float*)((char*)block + stride * 2);
+    soa.w = shape->is_4d ? (float*)((char*)block + stride * 3) : NULL;
+    for (int i = 0; i < shape->v_count; i++) {
+        soa.x[i] = shape->vertices[i].x;
+        soa.y[i] = shape->vertices[i].y;
+        soa.z[i] = shape->vertices[i].z;
+        if (soa.w) soa.w[i] = shape->vertices[i].w;
+    }
+
+    // Mapped vertices stay in the mapping next to the edges, their pages just go cold
+    if (!shape->mapping) free(shape->vertices);
+    shape->vertices = NULL;
+    shape->soa = soa;
     return 1;
-}
\ No newline at end of file
+}
+
+Vertex shape_vertex(const Polyhedron* shape, int i) {
+    if (shape->vertices) return shape->vertices[i];
+    if (shape->coords) {
+        const float* c = &shape->coords[(size_t)i * shape->dim];
+        return (Vertex){ c[0], c[1], c[2], c[3] };
+    }
+    const VertexSoA* soa = &shape->soa;
+    Vertex v = { soa->x[i], soa->y[i], soa->z[i], soa->w ? soa->w[i] : 0.0f };
+    return v;
+}
+
+int shape_dim(const Polyhedron* shape) {
+    if (shape->dim > 4) return shape->dim;
+    return shape->is_4d ? 4 : 3;
+}
+
+void free_shape(Polyhedron* shape) {
+    if (shape->mapping) {
+        #ifdef _WIN32
+        free(shape->mapping);
+        #else
+        munmap(shape->mapping, shape->mapping_size);
+        #endif
+    } else {
+        free(shape->vertices);
+        free(shape->coords);
+        free(shape->edges);
+    }
+    free_aligned(shape->soa.block);
+    memset(&shape->soa, 0, sizeof(shape->soa));
+    shape->vertices = NULL;
+    shape->coords = NULL;
+    shape->edges = NULL;
+    shape->mapping = NULL;
+    shape->mapping_size = 0;
+}
@@ -1,5 +1,8 @@
 #ifndef SHAPES_H
-#define SHAPES_h
+#define SHAPES_H
+
+#include <stddef.h>
+#include <stdint.h>
 
 // #include <math.h>
 
@@ -14,74 +17,75 @@ typedef struct {
 	int start, end;
 } Edge;
 
+// Structure-of-arrays copy of the vertices, one aligned array per component.
+// w is NULL for 3D shapes since it never affects their projection.
+#define SOA_ALIGN 64
+
+typedef struct {
+    float *x, *y, *z, *w;
+    void *block;		// Single allocation backing all components
+} VertexSoA;
+
+// Highest dimension a shape can declare. Up to 4D vertices are Vertex, above that packed float arrays
+#define POLY_MAX_DIM 8
+
 typedef struct {
     char name[32];
     int v_count;
     int e_count;
-	int is_4d;			// Flag for 4D Rotational Logic
-    Vertex *vertices;	// Dynamic Array
+	int is_4d;			// Flag for 4D Rotational Logic, set for every shape of 4 or more dimensions
+    int dim;			// Coordinates per vertex, 3 to POLY_MAX_DIM (0 reads as 3 or 4 by is_4d)
+    Vertex *vertices;	// Dynamic Array, NULL once converted with shape_to_soa or when dim > 4
+    float *coords;		// dim floats per vertex for shapes above 4D, NULL otherwise
     Edge *edges;		// Dynamic Array
+    VertexSoA soa;		// Empty unless converted
+    void *mapping;		// Backing file mapping for binary shapes, read-only (NULL if heap allocated)
+    size_t mapping_size;
 } Polyhedron;
 
-// Generic Loader
-int load_shape(const char* filename, Polyhedron* shape);
-
-// // Sphere surface resolution
-// #define SPHERE_RES_THETA 20
-// #define SPHERE_RES_PHI 20
-
-// // Mobius Strip resolution
-// #define MOBIUS_RES_U 50
-// #define MOBIUS_RES_V 10
-
-// // Hypersphere (4D) resolution
-// #define HYPER_RES_THETA1 10
-// #define HYPER_RES_THETA2 10
-// #define HYPER_RES_PHI 10
-
-// // CUBE
-// extern Vertex cube_v[8];
-// extern Edge cube_e[12];
+// Text Shape Format (.shape)
+// "Name D", "V E", then V lines "v ..." and E lines "e a b". D is 0 or 1 for a 3D or 4D shape with four
+// coordinates per vertex, or a dimension from 3 to POLY_MAX_DIM followed by that many coordinates per vertex.
+// Vertex-only files leave out E and have no "e" lines, see infer.h for giving them edges.
 
-// // ICOSAHEDRON - 20 Faces 12 Vertices - Golden Ration Construction
-// extern Vertex ico_v[12];
-// extern Edge ico_e[30];
-// void init_icosahedron();
+// Binary Shape Format (.shapeb)
+// Header, then packed vertex (Vertex, or dim floats above 4D) and Edge arrays at the given offsets.
+// Stored in native byte order, arrays aligned to SHAPEB_ALIGN so they can be used in place.
+// Version 1 files have no dimension and are 3D or 4D by is_4d.
+#define SHAPEB_MAGIC "PLYB"
+#define SHAPEB_VERSION 2
+#define SHAPEB_ALIGN 64
 
-// // DODECAHEDRON - 12 Faces 20 Vertices
-// extern Vertex dod_v[20];
-// extern Edge dod_e[30];
-// void init_dodecahedron();
-
-// // TRUNCATED OCTAHEDRON - 14 Faces 24 Vertices
-// extern Vertex toc_v[24];
-// extern Edge toc_e[36];
-// void init_truncated_octahedron();
-
-// // STELLA OCTANGULA (Compound of two tetrahedra) - 8 Faces 12 Vertices (unique)
-// extern Vertex soc_v[12];
-// extern Edge soc_e[24];
-// void init_stella_octangula();
-
-// // TESSERACT - 4D Hypercube - 16 Vertices 32 Edges
-// extern Vertex tes_v[16];
-// extern Edge tes_e[32];
-// void init_tesseract();
-
-// // SPHERE
-// extern Vertex sphere_v[(SPHERE_RES_THETA+1)*(SPHERE_RES_PHI+1)];
-// extern Edge sphere_e[SPHERE_RES_THETA*SPHERE_RES_PHI*2];
-// void init_sphere();
-
-// // MOBIUS STRIP
-// extern Vertex mobius_v[MOBIUS_RES_U*MOBIUS_RES_V];
-// extern Edge mobius_e[MOBIUS_RES_U*MOBIUS_RES_V*2];
-// void init_mobius();
-
-// // HYPERSPHERE (4D) - We also track actual_edges
-// extern Vertex hypersphere_v[HYPER_RES_THETA1*HYPER_RES_THETA2*HYPER_RES_PHI];
-// extern Edge hypersphere_e[HYPER_RES_THETA1*HYPER_RES_THETA2*HYPER_RES_PHI*6];
-// extern int actual_edges;
-// void init_hypersphere();
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    char name[32];
+    int32_t is_4d;
+    int32_t v_count;
+    int32_t e_count;
+    int32_t dim;		// Reserved in version 1
+    uint64_t vertex_offset;
+    uint64_t edge_offset;
+} ShapeBinaryHeader;
+
+// Generic Loader, picks the text or binary format from the file extension
+int load_shape(const char* filename, Polyhedron* shape);
+// Reads only the name, 4D flag and counts, vertices/edges are left NULL
+int load_shape_header(const char* filename, Polyhedron* shape);
+// Maps a .shapeb file, vertices and edges point straight into the mapping
+int load_shape_binary(const char* filename, Polyhedron* shape);
+// Writes a loaded shape out as .shapeb
+int save_shape_binary(const char* filename, const Polyhedron* shape);
+// Replace the vertex array with per-component arrays, 0 if out of memory (shape unchanged)
+int shape_to_soa(Polyhedron* shape);
+// Vertex i regardless of layout, the first four coordinates above 4D
+Vertex shape_vertex(const Polyhedron* shape, int i);
+// Coordinates per vertex, also for shapes built before dim existed
+int shape_dim(const Polyhedron* shape);
+// SOA_ALIGN aligned heap blocks
+void* alloc_aligned(size_t size);
+void free_aligned(void* p);
+// Releases vertex/edge storage, heap or mapped
+void free_shape(Polyhedron* shape);
 
 #endif
@@ -0,0 +1,42 @@
+#include "simclock.h"
+#include <string.h>
+
+void sim_init(SimClock* clock, double now) {
+    memset(clock, 0, sizeof(*clock));
+    clock->last_time = now;
+}
+
+void sim_advance(SimClock* clock, double now) {
+    double elapsed = now - clock->last_time;
+    clock->last_time = now;
+    if (elapsed > SIM_MAX_FRAME) elapsed = SIM_MAX_FRAME;
+    if (elapsed > 0.0) clock->accumulator += elapsed;
+
+    while (clock->accumulator >= SIM_STEP) {
+        for (int i = 0; i < SIM_ANGLES; i++) {
+            clock->previous[i] = clock->angles[i];
+            clock->angles[i] += clock->velocity[i] * (float)SIM_STEP;
+        }
+        clock->accumulator -= SIM_STEP;
+    }
+}
+
+void sim_resync(SimClock* clock, double now) {
+    clock->last_time = now;
+}
+
+void sim_present(const SimClock* clock, float out[SIM_ANGLES]) {
+    float alpha = (float)(clock->accumulator / SIM_STEP);
+    for (int i = 0; i < SIM_ANGLES; i++) {
+        out[i] = clock->previous[i] + (clock->angles[i] - clock->previous[i]) * alpha;
+    }
+}
+
+int sim_frame_due(const SimClock* clock, const float drawn[SIM_ANGLES]) {
+    for (int i = 0; i < SIM_ANGLES; i++) {
+        if (clock->velocity[i] != 0.0f) return 1;
+    }
+    float angles[SIM_ANGLES];
+    sim_present(clock, angles);
+    return memcmp(angles, drawn, sizeof(angles)) != 0;
+}
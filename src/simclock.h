@@ -0,0 +1,36 @@
+#ifndef SIMCLOCK_H
+#define SIMCLOCK_H
+
+// Simulation Clock
+// Rotation advances in fixed SIM_STEP steps of real time, independent of how often frames are drawn,
+// and frames show the state interpolated between the last two steps. Speeds are in radians per second,
+// so the animation looks the same uncapped, at vsync or at 30 Hz.
+
+#define SIM_ANGLES 5				// x, y, xw, yw, zw as view_transform() takes them
+#define SIM_STEP (1.0 / 120.0)		// Seconds per integration step
+#define SIM_MAX_FRAME 0.25			// Longer frames (stalls, breakpoints) are cut to this
+
+// Auto-rotate and rotation key speeds, what the per-frame steps used to be at 60 frames per second
+#define SIM_AUTO_ROTATE { 0.24f, 0.36f, 0.18f, 0.12f, 0.30f }
+#define SIM_KEY_SPEED 0.6f
+
+typedef struct {
+    float angles[SIM_ANGLES];		// After the latest step
+    float previous[SIM_ANGLES];		// One step before
+    float velocity[SIM_ANGLES];		// Radians per second, set by the caller before advancing
+    double accumulator;				// Real time not yet stepped
+    double last_time;
+} SimClock;
+
+void sim_init(SimClock* clock, double now);
+// Step through the real time passed since the last call
+void sim_advance(SimClock* clock, double now);
+// Forget the time since the last call, e.g. after sleeping while nothing moved
+void sim_resync(SimClock* clock, double now);
+// Angles to draw, between the last two steps by how far real time is into the next one
+void sim_present(const SimClock* clock, float out[SIM_ANGLES]);
+// Whether a frame would differ from one showing drawn. Always while any velocity is set, even before
+// the first step has built up, so a frame drawn right after waking keeps the clock running
+int sim_frame_due(const SimClock* clock, const float drawn[SIM_ANGLES]);
+
+#endif
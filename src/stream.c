@@ -0,0 +1,96 @@
+#include "stream.h"
+#include <string.h>
+
+// ARB_buffer_storage, not part of the 3.3 core loader
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT   0x0080
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+static int has_buffer_storage(void) {
+    GLint major = 0, minor = 0, count = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 4)) return 1;
+
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (name && strcmp(name, "GL_ARB_buffer_storage") == 0) return 1;
+    }
+    return 0;
+}
+
+int stream_init(StreamBuffer *stream, size_t region_size, GLADloadproc load) {
+    memset(stream, 0, sizeof(*stream));
+    stream->region_size = ((region_size > 0 ? region_size : 1) + 63) & ~(size_t)63;
+    size_t total = stream->region_size * STREAM_REGIONS;
+
+    glGenBuffers(1, &stream->buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+
+    PFNGLBUFFERSTORAGEPROC bufferStorage = has_buffer_storage() ? (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage") : NULL;
+    if (bufferStorage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        bufferStorage(GL_ARRAY_BUFFER, total, NULL, flags);
+        stream->mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, total, flags);
+        stream->persistent = stream->mapped != NULL;
+    }
+    if (!stream->persistent) {
+        // Immutable storage can't be respecified, start over with a mutable buffer
+        if (bufferStorage) {
+            glDeleteBuffers(1, &stream->buffer);
+            glGenBuffers(1, &stream->buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+        }
+        glBufferData(GL_ARRAY_BUFFER, total, NULL, GL_STREAM_DRAW);
+    }
+    return glGetError() == GL_NO_ERROR;
+}
+
+void stream_destroy(StreamBuffer *stream) {
+    for (int i = 0; i < STREAM_REGIONS; i++) {
+        if (stream->fences[i]) glDeleteSync(stream->fences[i]);
+    }
+    if (stream->mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    glDeleteBuffers(1, &stream->buffer);
+    memset(stream, 0, sizeof(*stream));
+}
+
+void *stream_map(StreamBuffer *stream, size_t bytes, size_t *offset) {
+    if (bytes > stream->region_size) return NULL;
+    *offset = stream->region * stream->region_size;
+
+    if (stream->persistent) {
+        // Wait until the GPU is done with what this region held STREAM_REGIONS frames ago
+        GLsync fence = stream->fences[stream->region];
+        if (fence) {
+            GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            while (glClientWaitSync(fence, flags, 1000000000) == GL_TIMEOUT_EXPIRED) flags = 0;
+            glDeleteSync(fence);
+            stream->fences[stream->region] = NULL;
+        }
+        return stream->mapped + *offset;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+    if (stream->region == 0) {
+        // Orphan: the driver hands out fresh storage while the GPU keeps reading the old one
+        glBufferData(GL_ARRAY_BUFFER, stream->region_size * STREAM_REGIONS, NULL, GL_STREAM_DRAW);
+    }
+    return glMapBufferRange(GL_ARRAY_BUFFER, *offset, bytes,
+                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void stream_unmap(StreamBuffer *stream) {
+    if (stream->persistent) return;
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+}
+
+void stream_fence(StreamBuffer *stream) {
+    if (stream->persistent) stream->fences[stream->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stream->region = (stream->region + 1) % STREAM_REGIONS;
+}
@@ -0,0 +1,34 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stddef.h>
+#include <glad/glad.h>
+
+// Streaming Vertex Buffer
+// A ring of STREAM_REGIONS regions the CPU writes projected vertices straight into, one region per frame.
+// With ARB_buffer_storage (or GL 4.4) the buffer stays persistently mapped and each region is guarded by a fence;
+// on plain GL 3.3 the buffer is orphaned when the ring wraps and regions are mapped unsynchronized.
+
+#define STREAM_REGIONS 3
+
+typedef struct {
+    GLuint buffer;
+    size_t region_size;		// Bytes per region, a multiple of 64
+    int region;				// Region the next frame writes
+    int persistent;
+    unsigned char *mapped;	// Persistent mapping of the whole ring
+    GLsync fences[STREAM_REGIONS];
+} StreamBuffer;
+
+// load resolves GL entry points outside the 3.3 core glad was generated for
+int stream_init(StreamBuffer *stream, size_t region_size, GLADloadproc load);
+void stream_destroy(StreamBuffer *stream);
+
+// Writable space for this frame's vertices, NULL on failure. *offset is its byte offset in stream->buffer
+void *stream_map(StreamBuffer *stream, size_t bytes, size_t *offset);
+// Call after writing, before drawing from the region
+void stream_unmap(StreamBuffer *stream);
+// Call after the draws reading the region have been issued, moves on to the next region
+void stream_fence(StreamBuffer *stream);
+
+#endif
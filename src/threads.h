@@ -0,0 +1,77 @@
+#ifndef THREADS_H
+#define THREADS_H
+
+// pthreads, or on Windows the handful of calls the pool and the library use mapped onto
+// Win32 threads, slim reader/writer locks and condition variables
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef HANDLE pthread_t;
+typedef SRWLOCK pthread_mutex_t;
+typedef CONDITION_VARIABLE pthread_cond_t;
+
+typedef struct {
+    void* (*start)(void*);
+    void* arg;
+} ThreadStart;
+
+static inline unsigned __stdcall thread_start(void* data) {
+    ThreadStart ts = *(ThreadStart*)data;
+    free(data);
+    ts.start(ts.arg);
+    return 0;
+}
+
+// Attributes are always NULL here
+static inline int pthread_create(pthread_t* thread, const void* attr, void* (*start)(void*), void* arg) {
+    (void)attr;
+    ThreadStart* ts = malloc(sizeof(ThreadStart));
+    if (!ts) return 1;
+    ts->start = start;
+    ts->arg = arg;
+    uintptr_t handle = _beginthreadex(NULL, 0, thread_start, ts, 0, NULL);
+    if (!handle) {
+        free(ts);
+        return 1;
+    }
+    *thread = (HANDLE)handle;
+    return 0;
+}
+
+static inline int pthread_join(pthread_t thread, void** result) {
+    if (result) *result = NULL;
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+    return 0;
+}
+
+static inline int pthread_mutex_init(pthread_mutex_t* mutex, const void* attr) { (void)attr; InitializeSRWLock(mutex); return 0; }
+static inline int pthread_mutex_destroy(pthread_mutex_t* mutex) { (void)mutex; return 0; }
+static inline int pthread_mutex_lock(pthread_mutex_t* mutex) { AcquireSRWLockExclusive(mutex); return 0; }
+static inline int pthread_mutex_unlock(pthread_mutex_t* mutex) { ReleaseSRWLockExclusive(mutex); return 0; }
+
+static inline int pthread_cond_init(pthread_cond_t* cond, const void* attr) { (void)attr; InitializeConditionVariable(cond); return 0; }
+static inline int pthread_cond_destroy(pthread_cond_t* cond) { (void)cond; return 0; }
+static inline int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+    return SleepConditionVariableSRW(cond, mutex, INFINITE, 0) ? 0 : 1;
+}
+static inline int pthread_cond_signal(pthread_cond_t* cond) { WakeConditionVariable(cond); return 0; }
+static inline int pthread_cond_broadcast(pthread_cond_t* cond) { WakeAllConditionVariable(cond); return 0; }
+
+// Returns the value before the add
+static inline int atomic_fetch_add_int(int* value, int add) {
+    return (int)InterlockedExchangeAdd((volatile LONG*)value, add);
+}
+#else
+#include <pthread.h>
+
+static inline int atomic_fetch_add_int(int* value, int add) {
+    return __atomic_fetch_add(value, add, __ATOMIC_RELAXED);
+}
+#endif
+
+#endif
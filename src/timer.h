@@ -0,0 +1,25 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+// Monotonic wall clock in seconds, usable without a GLFW context (tools, worker threads)
+
+#ifdef _WIN32
+#include <windows.h>
+
+static inline double timer_now(void) {
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+}
+#else
+#include <time.h>
+
+static inline double timer_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+#endif
+
+#endif
@@ -0,0 +1,344 @@
+#include "transform.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSFORM_X86 1
+#include <immintrin.h>
+#endif
+
+// Scalar SoA kernel, also finishes the tails of the SIMD ones
+static void project_soa_scalar(const Mat4* m, const Projection* proj, const VertexSoA* in, int count, float* out) {
+    const Mat4 r = *m;
+    const Projection pr = *proj;
+    for (int i = 0; i < count; i++) {
+        float x = in->x[i], y = in->y[i], z = in->z[i];
+        float ox = r.m[0] * x + r.m[1] * y + r.m[2] * z;
+        float oy = r.m[4] * x + r.m[5] * y + r.m[6] * z;
+        float oz = r.m[8] * x + r.m[9] * y + r.m[10] * z;
+
+        if (in->w) {
+            float w = in->w[i];
+            float ow = r.m[12] * x + r.m[13] * y + r.m[14] * z + r.m[15] * w;
+            ox = ox + r.m[3] * w;
+            oy = oy + r.m[7] * w;
+            oz = oz + r.m[11] * w;
+            float w_factor = 1.0f / (pr.w_distance - ow * pr.w_scale);
+            ox *= w_factor;
+            oy *= w_factor;
+            oz *= w_factor;
+        }
+
+        float factor = pr.focal / (pr.distance - oz * pr.z_scale);
+        out[2*i] = ox * factor;
+        out[2*i+1] = oy * factor;
+    }
+}
+
+// The same arrays starting at vertex i
+static VertexSoA soa_offset(const VertexSoA* in, int i) {
+    VertexSoA tail = { in->x + i, in->y + i, in->z + i, in->w ? in->w + i : NULL, NULL };
+    return tail;
+}
+
+#ifdef TRANSFORM_X86
+
+// Products are summed left to right like mat4_apply, and without FMA, so results match the scalar path exactly
+__attribute__((target("sse2")))
+static void project_sse2(const Mat4* m, const Projection* proj, int is_4d, const Vertex* in, int count, float* out) {
+    const float* r = m->m;
+    __m128 row[16];
+    for (int k = 0; k < 16; k++) row[k] = _mm_set1_ps(r[k]);
+    const __m128 w_distance = _mm_set1_ps(proj->w_distance), w_scale = _mm_set1_ps(proj->w_scale);
+    const __m128 distance = _mm_set1_ps(proj->distance), z_scale = _mm_set1_ps(proj->z_scale);
+    const __m128 focal = _mm_set1_ps(proj->focal);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // AoS -> SoA: one register per component
+        __m128 x = _mm_loadu_ps(&in[i].x);
+        __m128 y = _mm_loadu_ps(&in[i+1].x);
+        __m128 z = _mm_loadu_ps(&in[i+2].x);
+        __m128 w = _mm_loadu_ps(&in[i+3].x);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        __m128 ox = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(row[0], x), _mm_mul_ps(row[1], y)), _mm_mul_ps(row[2], z)), _mm_mul_ps(row[3], w));
+        __m128 oy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(row[4], x), _mm_mul_ps(row[5], y)), _mm_mul_ps(row[6], z)), _mm_mul_ps(row[7], w));
+        __m128 oz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(row[8], x), _mm_mul_ps(row[9], y)), _mm_mul_ps(row[10], z)), _mm_mul_ps(row[11], w));
+
+        if (is_4d) {
+            __m128 ow = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(row[12], x), _mm_mul_ps(row[13], y)), _mm_mul_ps(row[14], z)), _mm_mul_ps(row[15], w));
+            __m128 w_factor = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sub_ps(w_distance, _mm_mul_ps(ow, w_scale)));
+            ox = _mm_mul_ps(ox, w_factor);
+            oy = _mm_mul_ps(oy, w_factor);
+            oz = _mm_mul_ps(oz, w_factor);
+        }
+
+        __m128 factor = _mm_div_ps(focal, _mm_sub_ps(distance, _mm_mul_ps(oz, z_scale)));
+        ox = _mm_mul_ps(ox, factor);
+        oy = _mm_mul_ps(oy, factor);
+
+        // Back to interleaved x, y pairs
+        _mm_storeu_ps(out + 2*i, _mm_unpacklo_ps(ox, oy));
+        _mm_storeu_ps(out + 2*i + 4, _mm_unpackhi_ps(ox, oy));
+    }
+    project_vertices(m, proj, is_4d, in + i, count - i, out + 2*i);
+}
+
+__attribute__((target("avx2")))
+static void project_avx2(const Mat4* m, const Projection* proj, int is_4d, const Vertex* in, int count, float* out) {
+    const float* r = m->m;
+    __m256 row[16];
+    for (int k = 0; k < 16; k++) row[k] = _mm256_set1_ps(r[k]);
+    const __m256 w_distance = _mm256_set1_ps(proj->w_distance), w_scale = _mm256_set1_ps(proj->w_scale);
+    const __m256 distance = _mm256_set1_ps(proj->distance), z_scale = _mm256_set1_ps(proj->z_scale);
+    const __m256 focal = _mm256_set1_ps(proj->focal);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Vertices i..i+3 in the low lanes, i+4..i+7 in the high lanes, then transpose within each lane
+        __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&in[i].x)), _mm_loadu_ps(&in[i+4].x), 1);
+        __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&in[i+1].x)), _mm_loadu_ps(&in[i+5].x), 1);
+        __m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&in[i+2].x)), _mm_loadu_ps(&in[i+6].x), 1);
+        __m256 d = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&in[i+3].x)), _mm_loadu_ps(&in[i+7].x), 1);
+        __m256 t0 = _mm256_unpacklo_ps(a, b), t1 = _mm256_unpacklo_ps(c, d);
+        __m256 t2 = _mm256_unpackhi_ps(a, b), t3 = _mm256_unpackhi_ps(c, d);
+        __m256 x = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 y = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 z = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 w = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+        __m256 ox = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row[0], x), _mm256_mul_ps(row[1], y)), _mm256_mul_ps(row[2], z)), _mm256_mul_ps(row[3], w));
+        __m256 oy = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row[4], x), _mm256_mul_ps(row[5], y)), _mm256_mul_ps(row[6], z)), _mm256_mul_ps(row[7], w));
+        __m256 oz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row[8], x), _mm256_mul_ps(row[9], y)), _mm256_mul_ps(row[10], z)), _mm256_mul_ps(row[11], w));
+
+        if (is_4d) {
+            __m256 ow = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row[12], x), _mm256_mul_ps(row[13], y)), _mm256_mul_ps(row[14], z)), _mm256_mul_ps(row[15], w));
+            __m256 w_factor = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sub_ps(w_distance, _mm256_mul_ps(ow, w_scale)));
+            ox = _mm256_mul_ps(ox, w_factor);
+            oy = _mm256_mul_ps(oy, w_factor);
+            oz = _mm256_mul_ps(oz, w_factor);
+        }
+
+        __m256 factor = _mm256_div_ps(focal, _mm256_sub_ps(distance, _mm256_mul_ps(oz, z_scale)));
+        ox = _mm256_mul_ps(ox, factor);
+        oy = _mm256_mul_ps(oy, factor);
+
+        // Interleave per lane, then put the lanes back in vertex order
+        __m256 lo = _mm256_unpacklo_ps(ox, oy);
+        __m256 hi = _mm256_unpackhi_ps(ox, oy);
+        _mm256_storeu_ps(out + 2*i, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(out + 2*i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    project_vertices(m, proj, is_4d, in + i, count - i, out + 2*i);
+}
+
+// SoA input needs no transpose and the arrays are aligned, so these are plain aligned loads
+__attribute__((target("sse2")))
+static void project_soa_sse2(const Mat4* m, const Projection* proj, const VertexSoA* in, int count, float* out) {
+    const float* r = m->m;
+    __m128 row[16];
+    for (int k = 0; k < 16; k++) row[k] = _mm_set1_ps(r[k]);
+    const __m128 w_distance = _mm_set1_ps(proj->w_distance), w_scale = _mm_set1_ps(proj->w_scale);
+    const __m128 distance = _mm_set1_ps(proj->distance), z_scale = _mm_set1_ps(proj->z_scale);
+    const __m128 focal = _mm_set1_ps(proj->focal);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_load_ps(in->x + i), y = _mm_load_ps(in->y + i), z = _mm_load_ps(in->z + i);
+        __m128 ox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row[0], x), _mm_mul_ps(row[1], y)), _mm_mul_ps(row[2], z));
+        __m128 oy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row[4], x), _mm_mul_ps(row[5], y)), _mm_mul_ps(row[6], z));
+        __m128 oz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row[8], x), _mm_mul_ps(row[9], y)), _mm_mul_ps(row[10], z));
+
+        if (in->w) {
+            __m128 w = _mm_load_ps(in->w + i);
+            __m128 ow = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(row[12], x), _mm_mul_ps(row[13], y)), _mm_mul_ps(row[14], z)), _mm_mul_ps(row[15], w));
+            ox = _mm_add_ps(ox, _mm_mul_ps(row[3], w));
+            oy = _mm_add_ps(oy, _mm_mul_ps(row[7], w));
+            oz = _mm_add_ps(oz, _mm_mul_ps(row[11], w));
+            __m128 w_factor = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sub_ps(w_distance, _mm_mul_ps(ow, w_scale)));
+            ox = _mm_mul_ps(ox, w_factor);
+            oy = _mm_mul_ps(oy, w_factor);
+            oz = _mm_mul_ps(oz, w_factor);
+        }
+
+        __m128 factor = _mm_div_ps(focal, _mm_sub_ps(distance, _mm_mul_ps(oz, z_scale)));
+        ox = _mm_mul_ps(ox, factor);
+        oy = _mm_mul_ps(oy, factor);
+        _mm_storeu_ps(out + 2*i, _mm_unpacklo_ps(ox, oy));
+        _mm_storeu_ps(out + 2*i + 4, _mm_unpackhi_ps(ox, oy));
+    }
+    VertexSoA tail = soa_offset(in, i);
+    project_soa_scalar(m, proj, &tail, count - i, out + 2*i);
+}
+
+__attribute__((target("avx2")))
+static void project_soa_avx2(const Mat4* m, const Projection* proj, const VertexSoA* in, int count, float* out) {
+    const float* r = m->m;
+    __m256 row[16];
+    for (int k = 0; k < 16; k++) row[k] = _mm256_set1_ps(r[k]);
+    const __m256 w_distance = _mm256_set1_ps(proj->w_distance), w_scale = _mm256_set1_ps(proj->w_scale);
+    const __m256 distance = _mm256_set1_ps(proj->distance), z_scale = _mm256_set1_ps(proj->z_scale);
+    const __m256 focal = _mm256_set1_ps(proj->focal);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_load_ps(in->x + i), y = _mm256_load_ps(in->y + i), z = _mm256_load_ps(in->z + i);
+        __m256 ox = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row[0], x), _mm256_mul_ps(row[1], y)), _mm256_mul_ps(row[2], z));
+        __m256 oy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row[4], x), _mm256_mul_ps(row[5], y)), _mm256_mul_ps(row[6], z));
+        __m256 oz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row[8], x), _mm256_mul_ps(row[9], y)), _mm256_mul_ps(row[10], z));
+
+        if (in->w) {
+            __m256 w = _mm256_load_ps(in->w + i);
+            __m256 ow = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(row[12], x), _mm256_mul_ps(row[13], y)), _mm256_mul_ps(row[14], z)), _mm256_mul_ps(row[15], w));
+            ox = _mm256_add_ps(ox, _mm256_mul_ps(row[3], w));
+            oy = _mm256_add_ps(oy, _mm256_mul_ps(row[7], w));
+            oz = _mm256_add_ps(oz, _mm256_mul_ps(row[11], w));
+            __m256 w_factor = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sub_ps(w_distance, _mm256_mul_ps(ow, w_scale)));
+            ox = _mm256_mul_ps(ox, w_factor);
+            oy = _mm256_mul_ps(oy, w_factor);
+            oz = _mm256_mul_ps(oz, w_factor);
+        }
+
+        __m256 factor = _mm256_div_ps(focal, _mm256_sub_ps(distance, _mm256_mul_ps(oz, z_scale)));
+        ox = _mm256_mul_ps(ox, factor);
+        oy = _mm256_mul_ps(oy, factor);
+        __m256 lo = _mm256_unpacklo_ps(ox, oy);
+        __m256 hi = _mm256_unpackhi_ps(ox, oy);
+        _mm256_storeu_ps(out + 2*i, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(out + 2*i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    VertexSoA tail = soa_offset(in, i);
+    project_soa_scalar(m, proj, &tail, count - i, out + 2*i);
+}
+
+#endif
+
+ProjectKernel transform_kernel(KernelKind kind) {
+    switch (kind) {
+    case KERNEL_SCALAR:
+        return project_vertices;
+    #ifdef TRANSFORM_X86
+    case KERNEL_SSE2:
+        return __builtin_cpu_supports("sse2") ? project_sse2 : NULL;
+    case KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2") ? project_avx2 : NULL;
+    #endif
+    default:
+        return NULL;
+    }
+}
+
+ProjectSoAKernel transform_soa_kernel(KernelKind kind) {
+    switch (kind) {
+    case KERNEL_SCALAR:
+        return project_soa_scalar;
+    #ifdef TRANSFORM_X86
+    case KERNEL_SSE2:
+        return __builtin_cpu_supports("sse2") ? project_soa_sse2 : NULL;
+    case KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2") ? project_soa_avx2 : NULL;
+    #endif
+    default:
+        return NULL;
+    }
+}
+
+KernelKind transform_best_kernel(void) {
+    for (int kind = KERNEL_COUNT - 1; kind > KERNEL_SCALAR; kind--) {
+        if (transform_kernel((KernelKind)kind)) return (KernelKind)kind;
+    }
+    return KERNEL_SCALAR;
+}
+
+const char* transform_kernel_name(KernelKind kind) {
+    static const char* names[KERNEL_COUNT] = { "scalar", "sse2", "avx2" };
+    return kind >= 0 && kind < KERNEL_COUNT ? names[kind] : "unknown";
+}
+
+static ProjectKernel best_aos = NULL;
+static ProjectSoAKernel best_soa = NULL;
+
+// Resolved on first use, before any worker threads can ask
+static void resolve_kernels(void) {
+    if (best_aos) return;
+    KernelKind kind = transform_best_kernel();
+    best_soa = transform_soa_kernel(kind);
+    best_aos = transform_kernel(kind);
+}
+
+void transform_project(const Mat4* m, const Projection* proj, int is_4d, const Vertex* in, int count, float* out) {
+    resolve_kernels();
+    best_aos(m, proj, is_4d, in, count, out);
+}
+
+void transform_shape(const Mat4* m, const Projection* proj, const Polyhedron* shape, float* out) {
+    resolve_kernels();
+    if (shape->soa.block) best_soa(m, proj, &shape->soa, shape->v_count, out);
+    else best_aos(m, proj, shape->is_4d, shape->vertices, shape->v_count, out);
+}
+
+typedef struct {
+    const Mat4* m;
+    const Projection* proj;
+    const Polyhedron* shape;
+    float* out;
+} TransformJob;
+
+static void transform_range(void* ctx, int start, int end) {
+    const TransformJob* job = ctx;
+    const Polyhedron* shape = job->shape;
+    if (shape->soa.block) {
+        VertexSoA part = soa_offset(&shape->soa, start);
+        best_soa(job->m, job->proj, &part, end - start, job->out + 2*start);
+    } else {
+        best_aos(job->m, job->proj, shape->is_4d, shape->vertices + start, end - start, job->out + 2*start);
+    }
+}
+
+// About four chunks per thread so a slow core doesn't hold up the frame
+static int chunk_grain(WorkerPool* pool, int v_count) {
+    int threads = pool_thread_count(pool) + 1;
+    int grain = v_count / (threads * 4);
+    return (grain + TRANSFORM_CHUNK_ALIGN - 1) / TRANSFORM_CHUNK_ALIGN * TRANSFORM_CHUNK_ALIGN;
+}
+
+void transform_shape_parallel(WorkerPool* pool, const Mat4* m, const Projection* proj, const Polyhedron* shape, float* out) {
+    if (!pool || shape->v_count < TRANSFORM_PARALLEL_MIN) {
+        transform_shape(m, proj, shape, out);
+        return;
+    }
+    resolve_kernels();
+
+    TransformJob job = { m, proj, shape, out };
+    pool_parallel_for(pool, shape->v_count, chunk_grain(pool, shape->v_count), transform_range, &job);
+}
+
+typedef struct {
+    const MatN* m;
+    const Projection* proj;
+    const Polyhedron* shape;
+    float* out;			// x, y pairs
+    Vertex* out_4d;		// Or 4D shadows
+} TransformNJob;
+
+static void transform_n_range(void* ctx, int start, int end) {
+    const TransformNJob* job = ctx;
+    const float* in = job->shape->coords + (size_t)start * job->m->n;
+    if (job->out) project_vertices_n(job->m, job->proj, in, end - start, job->out + 2*start);
+    else project_vertices_n_to_4d(job->m, job->proj, in, end - start, job->out_4d + start);
+}
+
+static void transform_n(WorkerPool* pool, const TransformNJob* job) {
+    int v_count = job->shape->v_count;
+    if (!pool || v_count < TRANSFORM_PARALLEL_MIN) transform_n_range((void*)job, 0, v_count);
+    else pool_parallel_for(pool, v_count, chunk_grain(pool, v_count), transform_n_range, (void*)job);
+}
+
+void transform_shape_n(WorkerPool* pool, const MatN* m, const Projection* proj, const Polyhedron* shape, float* out) {
+    TransformNJob job = { m, proj, shape, out, NULL };
+    transform_n(pool, &job);
+}
+
+void transform_shape_n_to_4d(WorkerPool* pool, const MatN* m, const Projection* proj, const Polyhedron* shape, Vertex* out) {
+    TransformNJob job = { m, proj, shape, NULL, out };
+    transform_n(pool, &job);
+}
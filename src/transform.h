@@ -0,0 +1,48 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "math4d.h"
+#include "mathnd.h"
+#include "pool.h"
+
+// Vertex Transform Kernels
+// Batched versions of project_vertices(), picked at runtime from what the CPU supports.
+// All kernels perform the same float operations in the same order as the scalar one.
+
+typedef void (*ProjectKernel)(const Mat4* m, const Projection* proj, int is_4d, const Vertex* in, int count, float* out);
+// Same for shapes converted with shape_to_soa, 4D exactly when in->w is set
+typedef void (*ProjectSoAKernel)(const Mat4* m, const Projection* proj, const VertexSoA* in, int count, float* out);
+
+typedef enum {
+    KERNEL_SCALAR,
+    KERNEL_SSE2,		// 4 vertices per step
+    KERNEL_AVX2,		// 8 vertices per step
+    KERNEL_COUNT
+} KernelKind;
+
+// NULL if the kernel isn't built for this target or the CPU lacks the instructions
+ProjectKernel transform_kernel(KernelKind kind);
+ProjectSoAKernel transform_soa_kernel(KernelKind kind);
+KernelKind transform_best_kernel(void);
+const char* transform_kernel_name(KernelKind kind);
+
+// project_vertices() through the best available kernel
+void transform_project(const Mat4* m, const Projection* proj, int is_4d, const Vertex* in, int count, float* out);
+// Whole shape through the best kernel for its layout
+void transform_shape(const Mat4* m, const Projection* proj, const Polyhedron* shape, float* out);
+
+// Below this many vertices a frame's projection stays on the calling thread
+#define TRANSFORM_PARALLEL_MIN 32768
+// Chunk sizes are multiples of this, so chunk boundaries fall on cache lines of both the
+// SoA inputs (4 bytes per vertex) and the interleaved output (8 bytes per vertex)
+#define TRANSFORM_CHUNK_ALIGN 16
+
+// transform_shape() split across pool and the calling thread for large shapes
+void transform_shape_parallel(WorkerPool* pool, const Mat4* m, const Projection* proj, const Polyhedron* shape, float* out);
+
+// Shapes above 4D (shape->coords) through the kernel for their dimension, split the same way.
+// To x, y pairs in out, or with the _to_4d version to the 4D shadow the vertex shader finishes projecting
+void transform_shape_n(WorkerPool* pool, const MatN* m, const Projection* proj, const Polyhedron* shape, float* out);
+void transform_shape_n_to_4d(WorkerPool* pool, const MatN* m, const Projection* proj, const Polyhedron* shape, Vertex* out);
+
+#endif
@@ -0,0 +1,317 @@
+#include "wythoff.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Coordinates are rounded to multiples of 1/WYTHOFF_QUANTUM for hashing, points closer than
+// WYTHOFF_EPSILON in every coordinate are the same. Rounding error after H4's 14400 products stays far
+// below that, but a coordinate can still land either side of a rounding boundary, so lookups near one
+// try the neighbouring cell too
+#define WYTHOFF_QUANTUM 1e4
+#define WYTHOFF_EPSILON 1e-6
+// Past this the group can't be finite, it only guards against rounding gone wrong
+#define WYTHOFF_MAX_ORDER (1 << 20)
+
+// Growing set of 4D points, open addressing
+typedef struct {
+    double* points;		// 4 per point, in insertion order
+    int count, capacity;
+    int* slots;			// Point index + 1, 0 for an empty slot
+    size_t mask;
+} PointSet;
+
+// Growing set of edges, open addressing on both indices packed into one key
+typedef struct {
+    Edge* edges;
+    int count, capacity;
+    uint64_t* slots;	// Key + 1, 0 for an empty slot
+    size_t mask;
+} EdgeSet;
+
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t key_hash(const long long* key) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int k = 0; k < 4; k++) h = (h ^ (uint64_t)key[k]) * 0x100000001b3ULL;
+    return mix(h);
+}
+
+static uint64_t point_hash(const double* p) {
+    long long key[4];
+    for (int k = 0; k < 4; k++) key[k] = llround(p[k] * WYTHOFF_QUANTUM);
+    return key_hash(key);
+}
+
+static int same_point(const double* a, const double* b) {
+    for (int k = 0; k < 4; k++) {
+        if (fabs(a[k] - b[k]) > WYTHOFF_EPSILON) return 0;
+    }
+    return 1;
+}
+
+// Slots stay at most half full
+static int point_set_grow(PointSet* set) {
+    int capacity = set->capacity ? set->capacity * 2 : 256;
+    double* points = realloc(set->points, sizeof(double) * 4 * capacity);
+    if (!points) return 0;
+    set->points = points;
+    set->capacity = capacity;
+
+    size_t size = (size_t)capacity * 2;
+    int* slots = calloc(size, sizeof(int));
+    if (!slots) return 0;
+    free(set->slots);
+    set->slots = slots;
+    set->mask = size - 1;
+    for (int i = 0; i < set->count; i++) {
+        size_t slot = point_hash(&set->points[4 * i]) & set->mask;
+        while (set->slots[slot]) slot = (slot + 1) & set->mask;
+        set->slots[slot] = i + 1;
+    }
+    return 1;
+}
+
+// Point the same as p among those hashed to key, -1 if none. *empty is the slot the search ended on
+static int point_set_find(const PointSet* set, const double* p, const long long* key, size_t* empty) {
+    size_t slot = key_hash(key) & set->mask;
+    for (; set->slots[slot]; slot = (slot + 1) & set->mask) {
+        int i = set->slots[slot] - 1;
+        if (same_point(&set->points[4 * i], p)) return i;
+    }
+    *empty = slot;
+    return -1;
+}
+
+// Index of p, added if it's new. *added says which, -1 if out of memory
+static int point_set_add(PointSet* set, const double* p, int* added) {
+    *added = 0;
+    if (set->count == set->capacity && !point_set_grow(set)) return -1;
+    long long key[4], other[4];
+    int near = 0;
+    for (int k = 0; k < 4; k++) {
+        double scaled = p[k] * WYTHOFF_QUANTUM;
+        key[k] = llround(scaled);
+        other[k] = scaled < key[k] ? key[k] - 1 : key[k] + 1;
+        near |= (fabs(scaled - key[k]) >= 0.5 - WYTHOFF_EPSILON * WYTHOFF_QUANTUM) << k;
+    }
+    size_t slot, unused;
+    int i = point_set_find(set, p, key, &slot);
+    if (i >= 0) return i;
+    // Copies of p stored from the other side of a boundary: every mix of the cells it's near
+    for (int cells = near; cells; cells = (cells - 1) & near) {
+        long long neighbour[4];
+        for (int k = 0; k < 4; k++) neighbour[k] = (cells >> k & 1) ? other[k] : key[k];
+        i = point_set_find(set, p, neighbour, &unused);
+        if (i >= 0) return i;
+    }
+    memcpy(&set->points[4 * set->count], p, sizeof(double) * 4);
+    set->slots[slot] = ++set->count;
+    *added = 1;
+    return set->count - 1;
+}
+
+static int edge_set_grow(EdgeSet* set) {
+    int capacity = set->capacity ? set->capacity * 2 : 256;
+    Edge* edges = realloc(set->edges, sizeof(Edge) * capacity);
+    if (!edges) return 0;
+    set->edges = edges;
+    set->capacity = capacity;
+
+    size_t size = (size_t)capacity * 2;
+    uint64_t* slots = calloc(size, sizeof(uint64_t));
+    if (!slots) return 0;
+    free(set->slots);
+    set->slots = slots;
+    set->mask = size - 1;
+    for (int i = 0; i < set->count; i++) {
+        uint64_t key = (uint64_t)set->edges[i].start << 32 | (uint32_t)set->edges[i].end;
+        size_t slot = mix(key) & set->mask;
+        while (set->slots[slot]) slot = (slot + 1) & set->mask;
+        set->slots[slot] = key + 1;
+    }
+    return 1;
+}
+
+// 0 if out of memory
+static int edge_set_add(EdgeSet* set, int a, int b) {
+    if (set->count == set->capacity && !edge_set_grow(set)) return 0;
+    Edge edge = { a < b ? a : b, a < b ? b : a };
+    uint64_t key = (uint64_t)edge.start << 32 | (uint32_t)edge.end;
+    size_t slot = mix(key) & set->mask;
+    for (; set->slots[slot]; slot = (slot + 1) & set->mask) {
+        if (set->slots[slot] == key + 1) return 1;
+    }
+    set->slots[slot] = key + 1;
+    set->edges[set->count++] = edge;
+    return 1;
+}
+
+// m is 4x4 row-major
+static void apply(const double* m, const double* v, double* out) {
+    for (int r = 0; r < 4; r++) out[r] = m[4*r] * v[0] + m[4*r+1] * v[1] + m[4*r+2] * v[2] + m[4*r+3] * v[3];
+}
+
+static void multiply(const double* a, const double* b, double* out) {
+    for (int r = 0; r < 4; r++) {
+        for (int c = 0; c < 4; c++) {
+            out[4*r+c] = a[4*r] * b[c] + a[4*r+1] * b[4+c] + a[4*r+2] * b[8+c] + a[4*r+3] * b[12+c];
+        }
+    }
+}
+
+// Point with n_i . p = distance[i] for each mirror normal, the normals are the rows of the lower triangular L
+static void solve(const double L[4][4], const double* distance, double* p) {
+    for (int i = 0; i < 4; i++) {
+        double sum = distance[i];
+        for (int j = 0; j < i; j++) sum -= L[i][j] * p[j];
+        p[i] = sum / L[i][i];
+    }
+}
+
+int wythoff_build(const int labels[3], const int ringed[4], Polyhedron* shape) {
+    int any_ring = 0;
+    for (int i = 0; i < 3; i++) {
+        if (labels[i] < 2 || labels[i] > WYTHOFF_MAX_LABEL) {
+            fprintf(stderr, "Coxeter diagram labels go from 2 to %d, not %d\n", WYTHOFF_MAX_LABEL, labels[i]);
+            return 0;
+        }
+    }
+    for (int i = 0; i < 4; i++) any_ring |= ringed[i];
+    if (!any_ring) {
+        fprintf(stderr, "A Coxeter diagram needs at least one ringed node\n");
+        return 0;
+    }
+
+    // Gram matrix of the mirror normals, -cos(pi / label) between neighbours and 0 (label 2) between the rest
+    const double pi = 3.14159265358979323846;
+    double gram[4][4] = {{0}};
+    for (int i = 0; i < 4; i++) gram[i][i] = 1.0;
+    for (int i = 0; i < 3; i++) gram[i][i+1] = gram[i+1][i] = -cos(pi / labels[i]);
+
+    // Cholesky, rows of L are unit normals with exactly those angles. Not positive definite means not finite
+    double L[4][4] = {{0}};
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j <= i; j++) {
+            double sum = gram[i][j];
+            for (int k = 0; k < j; k++) sum -= L[i][k] * L[j][k];
+            if (i == j) {
+                if (sum < 1e-9) {
+                    fprintf(stderr, "{%d,%d,%d} isn't a finite reflection group, it has no polytope\n",
+                            labels[0], labels[1], labels[2]);
+                    return 0;
+                }
+                L[i][i] = sqrt(sum);
+            } else {
+                L[i][j] = sum / L[j][j];
+            }
+        }
+    }
+    double mirrors[4][16];
+    for (int i = 0; i < 4; i++) {
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++) mirrors[i][4*r+c] = (r == c) - 2.0 * L[i][r] * L[i][c];
+        }
+    }
+
+    // The chamber point has a different image under every element, the vertex sits on the unringed mirrors
+    double ones[4] = { 1.0, 1.0, 1.0, 1.0 }, distance[4], chamber[4], vertex[4];
+    for (int i = 0; i < 4; i++) distance[i] = ringed[i];
+    solve(L, ones, chamber);
+    solve(L, distance, vertex);
+    double reflected_chamber[4][4], reflected_vertex[4][4];
+    for (int i = 0; i < 4; i++) {
+        apply(mirrors[i], chamber, reflected_chamber[i]);
+        apply(mirrors[i], vertex, reflected_vertex[i]);
+    }
+
+    // Breadth first over the group, each element g is stored as its matrix and found again by g(chamber)
+    PointSet chambers = {0}, vertices = {0};
+    EdgeSet edges = {0};
+    double* elements = NULL;
+    int element_count = 0, element_capacity = 0, ok = 1, added;
+    static const double identity[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+    ok = point_set_add(&chambers, chamber, &added) >= 0 && (elements = malloc(sizeof(double) * 16 * 256)) != NULL;
+    if (ok) {
+        element_capacity = 256;
+        memcpy(elements, identity, sizeof(identity));
+        element_count = 1;
+    }
+    for (int e = 0; ok && e < element_count; e++) {
+        for (int j = 0; j < 4 && ok; j++) {
+            double image[4];
+            apply(&elements[16 * e], reflected_chamber[j], image);
+            ok = point_set_add(&chambers, image, &added) >= 0;
+            if (!ok || !added) continue;
+            if (element_count == WYTHOFF_MAX_ORDER) {
+                fprintf(stderr, "{%d,%d,%d} has more than %d elements, rounding went wrong\n",
+                        labels[0], labels[1], labels[2], WYTHOFF_MAX_ORDER);
+                ok = 0;
+                break;
+            }
+            if (element_count == element_capacity) {
+                double* grown = realloc(elements, sizeof(double) * 16 * element_capacity * 2);
+                if (!(ok = grown != NULL)) break;
+                elements = grown;
+                element_capacity *= 2;
+            }
+            multiply(&elements[16 * e], mirrors[j], &elements[16 * element_count++]);
+        }
+    }
+
+    // g(vertex) is every vertex, g(vertex) to g(mirror i (vertex)) every edge of ringed mirror i's orbit
+    for (int e = 0; ok && e < element_count; e++) {
+        double image[4];
+        apply(&elements[16 * e], vertex, image);
+        int a = point_set_add(&vertices, image, &added);
+        for (int i = 0; i < 4 && ok && a >= 0; i++) {
+            if (!ringed[i]) continue;
+            apply(&elements[16 * e], reflected_vertex[i], image);
+            int b = point_set_add(&vertices, image, &added);
+            ok = b >= 0 && edge_set_add(&edges, a, b);
+        }
+        ok = ok && a >= 0;
+    }
+
+    if (ok) {
+        shape->dim = 4;
+        shape->is_4d = 1;
+        shape->v_count = vertices.count;
+        shape->e_count = edges.count;
+        shape->vertices = malloc(sizeof(Vertex) * vertices.count);
+        ok = shape->vertices != NULL;
+    }
+    if (ok) {
+        double radius = sqrt(vertex[0]*vertex[0] + vertex[1]*vertex[1] + vertex[2]*vertex[2] + vertex[3]*vertex[3]);
+        double scale = 2.0 / radius;
+        for (int i = 0; i < vertices.count; i++) {
+            const double* p = &vertices.points[4 * i];
+            shape->vertices[i] = (Vertex){ (float)(p[0] * scale), (float)(p[1] * scale), (float)(p[2] * scale), (float)(p[3] * scale) };
+        }
+        // The set's array becomes the shape's, cut to size
+        Edge* fitted = realloc(edges.edges, sizeof(Edge) * edges.count);
+        shape->edges = fitted ? fitted : edges.edges;
+        edges.edges = NULL;
+    } else if (element_count < WYTHOFF_MAX_ORDER) {
+        fprintf(stderr, "Out of memory building {%d,%d,%d} after %d group elements\n", labels[0], labels[1], labels[2], element_count);
+    }
+    if (!ok) {
+        free(shape->vertices);
+        shape->vertices = NULL;
+    }
+
+    free(chambers.points);
+    free(chambers.slots);
+    free(vertices.points);
+    free(vertices.slots);
+    free(edges.edges);
+    free(edges.slots);
+    free(elements);
+    return ok;
+}
@@ -0,0 +1,21 @@
+#ifndef WYTHOFF_H
+#define WYTHOFF_H
+
+#include "shapes.h"
+
+// Wythoff Construction
+// Uniform 4-polytopes from a linear Coxeter diagram o-P-o-Q-o-R-o with some nodes ringed:
+// {5,3,3} with the first node ringed is the 120-cell, with the last one the 600-cell, two rings truncate.
+// The mirrors come from the Cholesky factor of the diagram's Gram matrix, which also tells finite groups
+// from infinite ones. Every group element is enumerated by reflecting a point inside the fundamental chamber,
+// deduplicated through a hash of its rounded coordinates (H4 has 14400). The vertex lies at distance 1 from
+// the ringed mirrors and on the others, and each ringed mirror gives one edge orbit.
+
+// Branch labels, 2 leaves two nodes unconnected (prisms and duoprisms)
+#define WYTHOFF_MAX_LABEL 32
+
+// labels are P, Q, R and ringed is 0 or 1 per node. Scaled to circumradius 2 like the tesseract, shape's name
+// is left alone. 0 with a message on stderr if the diagram is infinite, has no rings or is out of memory
+int wythoff_build(const int labels[3], const int ringed[4], Polyhedron* shape);
+
+#endif
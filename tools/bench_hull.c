@@ -0,0 +1,148 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hull.h"
+#include "wythoff.h"
+#include "timer.h"
+
+// 4D convex hull (--hull) phase times by thread count on random points on the 3-sphere or a
+// vertex-only file (--rounded first merges cells like --hull-rounded). The tesseract, 600-cell, 120-cell
+// and a lattice full of coplanar points have to come out with their known cells and edges, and random
+// points, all in general position, with every facet a cell and edges = vertices + cells (Euler for a
+// simplicial 4-polytope). Exits 1 if any check fails.
+
+static int make_shape(Polyhedron* shape, const char* name, int v_count) {
+    memset(shape, 0, sizeof(*shape));
+    snprintf(shape->name, sizeof(shape->name), "%s", name);
+    shape->is_4d = 1;
+    shape->dim = 4;
+    shape->v_count = v_count;
+    shape->vertices = malloc(sizeof(Vertex) * v_count);
+    return shape->vertices != NULL;
+}
+
+// 16 vertices, 8 cubes, 32 edges
+static int make_tesseract(Polyhedron* shape) {
+    if (!make_shape(shape, "tesseract", 16)) return 0;
+    for (int i = 0; i < 16; i++) {
+        shape->vertices[i] = (Vertex){ i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, i & 8 ? 1.0f : -1.0f };
+    }
+    return 1;
+}
+
+// side^4 points one apart, only the 16 corners are on the hull
+static int make_lattice(Polyhedron* shape, int side) {
+    if (!make_shape(shape, "lattice", side * side * side * side)) return 0;
+    for (int i = 0; i < shape->v_count; i++) {
+        shape->vertices[i] = (Vertex){ i % side, i / side % side, i / (side * side) % side, i / (side * side * side) };
+    }
+    return 1;
+}
+
+static int make_wythoff(Polyhedron* shape, const char* name, int first, int last) {
+    static const int labels[3] = { 5, 3, 3 };
+    int ringed[4] = { first, 0, 0, last };
+    memset(shape, 0, sizeof(*shape));
+    snprintf(shape->name, sizeof(shape->name), "%s", name);
+    return wythoff_build(labels, ringed, shape);
+}
+
+// Uniform on the 3-sphere: normalised gaussians, same seed every run
+static int make_sphere(Polyhedron* shape, int count) {
+    if (!make_shape(shape, "sphere", count)) return 0;
+    srand(1);
+    for (int i = 0; i < count; i++) {
+        double g[4], length = 0.0;
+        for (int k = 0; k < 4; k++) {
+            double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+            g[k] = sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+            length += g[k] * g[k];
+        }
+        length = sqrt(length);
+        shape->vertices[i] = (Vertex){ g[0] / length, g[1] / length, g[2] / length, g[3] / length };
+    }
+    return 1;
+}
+
+static int check_known(Polyhedron* shape, double rounding, int cells, int edges) {
+    HullStats stats;
+    free(shape->edges);
+    shape->edges = NULL;
+    shape->e_count = 0;
+    int ok = hull_edges(shape, NULL, rounding, &stats);
+    if (ok) {
+        ok = stats.cells == cells && stats.edges == edges && stats.skipped == 0;
+        fprintf(stdout, "%-10s %6d vertices %5d cells %5d ridges %6d edges, expected %d and %d: %s%s", shape->name,
+                stats.vertices, stats.cells, stats.ridges, stats.edges, cells, edges, ok ? "ok" : "WRONG",
+                stats.fallback ? " (incremental)" : "");
+        if (stats.skipped) fprintf(stdout, " (skipped %d points)", stats.skipped);
+        fprintf(stdout, "\n");
+    }
+    free_shape(shape);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    int failures = 0;
+    Polyhedron known;
+    failures += !make_tesseract(&known) || !check_known(&known, 0.0, 8, 32);
+    failures += !make_lattice(&known, 6) || !check_known(&known, 0.0, 8, 32);
+    failures += !make_wythoff(&known, "600-cell", 0, 1) || !check_known(&known, 0.0, 600, 720);
+    // Golden ratio coordinates in floats: the dodecahedra are only flat to within rounding
+    failures += !make_wythoff(&known, "120-cell", 1, 0) || !check_known(&known, HULL_ROUNDING, 120, 1200);
+
+    // A point count, or a vertex-only shape file
+    double rounding = 0.0;
+    if (argc > 1 && strcmp(argv[1], "--rounded") == 0) {
+        rounding = HULL_ROUNDING;
+        argv++;
+        argc--;
+    }
+    Polyhedron shape;
+    const char* source = argc > 1 ? argv[1] : "100000";
+    char* end;
+    long count = strtol(source, &end, 10);
+    int random = *end == '\0';
+    if (random) {
+        if (count < 5 || count > 10000000 || !make_sphere(&shape, (int)count)) {
+            fprintf(stderr, "Can't make %s points on a sphere\n", source);
+            return 1;
+        }
+    }
+    else if (!load_shape(source, &shape)) {
+        return 1;
+    }
+
+    fprintf(stdout, "\n%s: %d vertices in %dD\n", shape.name, shape.v_count, shape_dim(&shape));
+    fprintf(stdout, "%-8s", "threads");
+    for (int phase = 0; phase < HULL_PHASES; phase++) fprintf(stdout, " %10s", hull_phase_names[phase]);
+    fprintf(stdout, " %10s %8s %9s %8s %8s\n", "ms", "speedup", "simplices", "cells", "edges");
+    int cores = pool_cpu_count();
+    double base = 0.0;
+    for (int threads = 1; ; threads = threads * 2 < cores ? threads * 2 : cores) {
+        WorkerPool* pool = threads > 1 ? pool_create(threads - 1) : NULL;
+        HullStats stats;
+        double start = timer_now();
+        int ok = hull_edges(&shape, pool, rounding, &stats);
+        double ms = (timer_now() - start) * 1000.0;
+        pool_destroy(pool);
+        if (!ok) return 1;
+
+        if (threads == 1) base = ms;
+        fprintf(stdout, "%-8d", threads);
+        for (int phase = 0; phase < HULL_PHASES; phase++) fprintf(stdout, " %10.2f", stats.seconds[phase] * 1000.0);
+        // Points left out of an incremental build make the hull wrong whatever the input
+        int right = stats.skipped == 0;
+        if (random) right &= stats.cells == stats.simplices && stats.edges == stats.vertices + stats.simplices;
+        failures += !right;
+        fprintf(stdout, " %10.2f %7.2fx %9d %8d %8d%s%s", ms, base / ms, stats.simplices, stats.cells, stats.edges,
+                random || !right ? (right ? " ok" : " WRONG") : "", stats.fallback ? " (incremental)" : "");
+        if (stats.skipped) fprintf(stdout, " (skipped %d points)", stats.skipped);
+        fprintf(stdout, "\n");
+        if (threads == cores) break;
+    }
+
+    free_shape(&shape);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "infer.h"
+#include "timer.h"
+
+// Edge inference (--infer-edges) by thread count on a 4D lattice or a vertex-only file,
+// checked against comparing every pair of vertices. The 600-cell and tesseract have to come
+// out with their known edge counts. Exits 1 if any check fails.
+
+static int make_shape(Polyhedron* shape, const char* name, int v_count) {
+    memset(shape, 0, sizeof(*shape));
+    snprintf(shape->name, sizeof(shape->name), "%s", name);
+    shape->is_4d = 1;
+    shape->dim = 4;
+    shape->v_count = v_count;
+    shape->vertices = malloc(sizeof(Vertex) * v_count);
+    return shape->vertices != NULL;
+}
+
+// side^4 points one apart, 4 side^3 (side - 1) edges
+static int make_lattice(Polyhedron* shape, int side) {
+    if (!make_shape(shape, "lattice", side * side * side * side)) return 0;
+    for (int i = 0; i < shape->v_count; i++) {
+        shape->vertices[i] = (Vertex){ i % side, i / side % side, i / (side * side) % side, i / (side * side * side) };
+    }
+    return 1;
+}
+
+// 120 vertices, 720 edges of length 1/phi
+static int make_600_cell(Polyhedron* shape) {
+    if (!make_shape(shape, "600-cell", 120)) return 0;
+    const float phi = 1.61803398875f;
+    // Even permutations of four positions
+    static const int even[12][4] = {
+        {0,1,2,3}, {0,2,3,1}, {0,3,1,2}, {1,0,3,2}, {1,2,0,3}, {1,3,2,0},
+        {2,0,1,3}, {2,1,3,0}, {2,3,0,1}, {3,0,2,1}, {3,1,0,2}, {3,2,1,0}
+    };
+    int n = 0;
+    for (int k = 0; k < 8; k++) {
+        float v[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        v[k / 2] = k % 2 ? -1.0f : 1.0f;
+        shape->vertices[n++] = (Vertex){ v[0], v[1], v[2], v[3] };
+    }
+    for (int k = 0; k < 16; k++) {
+        shape->vertices[n++] = (Vertex){ k & 1 ? -0.5f : 0.5f, k & 2 ? -0.5f : 0.5f, k & 4 ? -0.5f : 0.5f, k & 8 ? -0.5f : 0.5f };
+    }
+    for (int p = 0; p < 12; p++) {
+        for (int k = 0; k < 8; k++) {
+            float base[4] = { phi * 0.5f, 0.5f, 0.5f / phi, 0.0f }, v[4];
+            for (int c = 0; c < 3; c++) {
+                if (k & (1 << c)) base[c] = -base[c];
+            }
+            for (int c = 0; c < 4; c++) v[even[p][c]] = base[c];
+            shape->vertices[n++] = (Vertex){ v[0], v[1], v[2], v[3] };
+        }
+    }
+    return 1;
+}
+
+// 16 vertices, 32 edges
+static int make_tesseract(Polyhedron* shape) {
+    if (!make_shape(shape, "tesseract", 16)) return 0;
+    for (int i = 0; i < 16; i++) {
+        shape->vertices[i] = (Vertex){ i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, i & 8 ? 1.0f : -1.0f };
+    }
+    return 1;
+}
+
+static float distance2(const Polyhedron* shape, int a, int b) {
+    Vertex p = shape_vertex(shape, a), q = shape_vertex(shape, b);
+    float dx = p.x - q.x, dy = p.y - q.y, dz = p.z - q.z, dw = p.w - q.w;
+    return dx*dx + dy*dy + dz*dz + dw*dw;
+}
+
+// The O(n^2) way, every pair within the tolerance of the minimum distance
+static Edge* all_pairs(const Polyhedron* shape, int* count) {
+    float nearest = INFINITY;
+    for (int i = 0; i < shape->v_count; i++) {
+        for (int j = i + 1; j < shape->v_count; j++) {
+            float d2 = distance2(shape, i, j);
+            if (d2 > 0.0f && d2 < nearest) nearest = d2;
+        }
+    }
+    float longest = sqrtf(nearest) * (1.0f + INFER_TOLERANCE);
+    Edge* edges = NULL;
+    int capacity = 0;
+    *count = 0;
+    for (int i = 0; i < shape->v_count; i++) {
+        for (int j = i + 1; j < shape->v_count; j++) {
+            float d2 = distance2(shape, i, j);
+            if (d2 == 0.0f || d2 > longest * longest) continue;
+            if (*count == capacity) {
+                capacity = capacity ? capacity * 2 : 1024;
+                edges = realloc(edges, sizeof(Edge) * capacity);
+            }
+            edges[(*count)++] = (Edge){ i, j };
+        }
+    }
+    return edges;
+}
+
+static int compare_edges(const void* a, const void* b) {
+    const Edge* x = a;
+    const Edge* y = b;
+    if (x->start != y->start) return x->start < y->start ? -1 : 1;
+    return (x->end > y->end) - (x->end < y->end);
+}
+
+// Same edges in any order
+static int same_edges(Edge* a, int a_count, Edge* b, int b_count) {
+    if (a_count != b_count) return 0;
+    qsort(a, a_count, sizeof(Edge), compare_edges);
+    qsort(b, b_count, sizeof(Edge), compare_edges);
+    return memcmp(a, b, sizeof(Edge) * a_count) == 0;
+}
+
+static int check_known(Polyhedron* shape, int expected) {
+    float length;
+    int ok = infer_edges(shape, NULL, &length) && shape->e_count == expected;
+    fprintf(stdout, "%-10s %6d vertices %6d edges of length %.4f, expected %d: %s\n", shape->name, shape->v_count,
+            shape->e_count, length, expected, ok ? "ok" : "WRONG");
+    free_shape(shape);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    int failures = 0;
+    Polyhedron known;
+    failures += !make_600_cell(&known) || !check_known(&known, 720);
+    failures += !make_tesseract(&known) || !check_known(&known, 32);
+
+    // A lattice side, or a vertex-only shape file. The default is small enough to compare every pair
+    Polyhedron shape;
+    const char* source = argc > 1 ? argv[1] : "11";
+    char* end;
+    long side = strtol(source, &end, 10);
+    if (*end == '\0') {
+        if (side < 2 || side > 200 || !make_lattice(&shape, (int)side)) {
+            fprintf(stderr, "Can't make a lattice with side %s\n", source);
+            return 1;
+        }
+    }
+    else if (!load_shape(source, &shape)) {
+        return 1;
+    }
+    free(shape.edges);
+    shape.edges = NULL;
+    shape.e_count = 0;
+
+    fprintf(stdout, "\n%s: %d vertices in %dD\n", shape.name, shape.v_count, shape_dim(&shape));
+    fprintf(stdout, "%-8s %12s %8s %10s\n", "threads", "ms", "speedup", "edges");
+    int cores = pool_cpu_count();
+    double base = 0.0;
+    Edge* reference = NULL;
+    int reference_count = 0;
+    for (int threads = 1; ; threads = threads * 2 < cores ? threads * 2 : cores) {
+        WorkerPool* pool = threads > 1 ? pool_create(threads - 1) : NULL;
+        double start = timer_now();
+        int ok = infer_edges(&shape, pool, NULL);
+        double ms = (timer_now() - start) * 1000.0;
+        pool_destroy(pool);
+        if (!ok) return 1;
+
+        const char* edges = "reference";
+        if (threads == 1) {
+            base = ms;
+            reference = shape.edges;
+            reference_count = shape.e_count;
+            shape.edges = NULL;
+        }
+        else {
+            edges = shape.e_count == reference_count && memcmp(shape.edges, reference, sizeof(Edge) * reference_count) == 0
+                  ? "same" : "DIFFER";
+            failures += edges[0] == 'D';
+        }
+        fprintf(stdout, "%-8d %12.2f %7.2fx %10d %s\n", threads, ms, base / ms, reference_count, edges);
+        if (threads == cores) break;
+    }
+
+    // Every pair only while that finishes in a few seconds
+    if (shape.v_count <= 20000) {
+        int pair_count;
+        double start = timer_now();
+        Edge* pairs = all_pairs(&shape, &pair_count);
+        double ms = (timer_now() - start) * 1000.0;
+        int same = same_edges(pairs, pair_count, reference, reference_count);
+        fprintf(stdout, "%-8s %12.2f %7.2fx %10d %s\n", "pairs", ms, base / ms, pair_count, same ? "same" : "DIFFER");
+        failures += !same;
+        free(pairs);
+    }
+
+    free(reference);
+    free_shape(&shape);
+    return failures ? 1 : 0;
+}
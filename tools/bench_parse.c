@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shapes.h"
+#include "timer.h"
+
+// Text loader throughput: the original fscanf loader against load_shape,
+// on generated shapes of 10^3 up to 10^max_exp edges.
+
+// The fscanf based loader load_shape used before the hand-written parser
+static int load_shape_fscanf(const char* filename, Polyhedron* shape) {
+    FILE* file = fopen(filename, "r");
+    if (!file) return 0;
+
+    memset(shape, 0, sizeof(*shape));
+    if (fscanf(file, "%31s %d", shape->name, &shape->is_4d) != 2 ||
+        fscanf(file, "%d %d", &shape->v_count, &shape->e_count) != 2) {
+        fclose(file);
+        return 0;
+    }
+
+    shape->vertices = (Vertex*)malloc(sizeof(Vertex) * shape->v_count);
+    shape->edges = (Edge*)malloc(sizeof(Edge) * shape->e_count);
+
+    char line_type;
+    int v_idx = 0, e_idx = 0;
+    while (v_idx < shape->v_count || e_idx < shape->e_count) {
+        if (fscanf(file, " %c", &line_type) != 1) break;
+
+        if (line_type == 'v' && v_idx < shape->v_count) {
+            fscanf(file, "%f %f %f %f", &shape->vertices[v_idx].x, &shape->vertices[v_idx].y,
+                                        &shape->vertices[v_idx].z, &shape->vertices[v_idx].w);
+            v_idx++;
+        } else if (line_type == 'e' && e_idx < shape->e_count) {
+            fscanf(file, "%d %d", &shape->edges[e_idx].start, &shape->edges[e_idx].end);
+            e_idx++;
+        }
+    }
+
+    fclose(file);
+    return 1;
+}
+
+// Random 4D point cloud with e_count random edges, half as many vertices
+static long write_shape(const char* path, int e_count) {
+    FILE* file = fopen(path, "w");
+    if (!file) return -1;
+
+    int v_count = e_count / 2 > 2 ? e_count / 2 : 2;
+    fprintf(file, "Bench 1\n%d %d\n", v_count, e_count);
+    for (int i = 0; i < v_count; i++) {
+        fprintf(file, "v %.6f %.6f %.6f %.6f\n",
+                rand() / (float)RAND_MAX * 2.0f - 1.0f, rand() / (float)RAND_MAX * 2.0f - 1.0f,
+                rand() / (float)RAND_MAX * 2.0f - 1.0f, rand() / (float)RAND_MAX * 2.0f - 1.0f);
+    }
+    for (int i = 0; i < e_count; i++) {
+        fprintf(file, "e %d %d\n", rand() % v_count, rand() % v_count);
+    }
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// Best of a few runs, in seconds
+static double time_loader(int (*loader)(const char*, Polyhedron*), const char* path, Polyhedron* out) {
+    double best = 1e30;
+    for (int run = 0; run < 3; run++) {
+        Polyhedron shape;
+        double start = timer_now();
+        if (!loader(path, &shape)) return -1.0;
+        double elapsed = timer_now() - start;
+        if (elapsed < best) best = elapsed;
+        if (run == 0) *out = shape;
+        else free_shape(&shape);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int max_exp = argc > 1 ? atoi(argv[1]) : 7;
+    const char* path = argc > 2 ? argv[2] : "bench_parse.shape";
+    srand(1);
+
+    fprintf(stdout, "%10s %10s %14s %14s %8s\n", "edges", "MB", "fscanf MB/s", "parser MB/s", "speedup");
+    for (int exp = 3, e_count = 1000; exp <= max_exp; exp++, e_count *= 10) {
+        long size = write_shape(path, e_count);
+        if (size < 0) {
+            fprintf(stderr, "Failed to write \"%s\"\n", path);
+            return 1;
+        }
+
+        Polyhedron old_shape, new_shape;
+        double t_old = time_loader(load_shape_fscanf, path, &old_shape);
+        double t_new = time_loader(load_shape, path, &new_shape);
+        if (t_old < 0 || t_new < 0) {
+            fprintf(stderr, "Failed to load \"%s\"\n", path);
+            return 1;
+        }
+
+        // Both loaders must agree on every value
+        if (memcmp(old_shape.vertices, new_shape.vertices, sizeof(Vertex) * new_shape.v_count) != 0 ||
+            memcmp(old_shape.edges, new_shape.edges, sizeof(Edge) * new_shape.e_count) != 0) {
+            fprintf(stderr, "Loaders disagree at %d edges\n", e_count);
+            free_shape(&old_shape);
+            free_shape(&new_shape);
+            remove(path);
+            return 1;
+        }
+        free_shape(&old_shape);
+        free_shape(&new_shape);
+
+        double mb = size / (1024.0 * 1024.0);
+        fprintf(stdout, "%10d %10.2f %14.1f %14.1f %7.1fx\n", e_count, mb, mb / t_old, mb / t_new, t_old / t_new);
+    }
+    remove(path);
+    return 0;
+}
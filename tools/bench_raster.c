@@ -0,0 +1,191 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "raster.h"
+#include "transform.h"
+#include "timer.h"
+#ifdef POLYHEDRA_EGL
+#include "headless.h"
+#endif
+
+// Frame time of the software rasterizer (--renderer=software) by thread count, against drawing the
+// same projected lines through GL on an offscreen EGL context when the build has EGL.
+// Every thread count has to produce the same image as one thread.
+
+#define WIDTH  1200
+#define HEIGHT 800
+
+static Raster* bench_raster;
+static const float* bench_xy;
+static const Polyhedron* bench_shape;
+
+static void draw_software(void) {
+    raster_draw(bench_raster, bench_xy, bench_shape->v_count, bench_shape->edges, bench_shape->e_count);
+}
+
+// Milliseconds per frame over enough frames to run for about half a second
+static double measure(void (*frame)(void)) {
+    int frames = 0;
+    double start = timer_now(), elapsed;
+    do {
+        frame();
+        frames++;
+        elapsed = timer_now() - start;
+    } while (elapsed < 0.5);
+    return elapsed * 1000.0 / frames;
+}
+
+// The torus stressgen writes, side x side vertices and twice as many edges
+static int make_torus(Polyhedron* shape, int edges) {
+    int side = (int)sqrt(edges / 2.0);
+    if (side < 2) side = 2;
+    memset(shape, 0, sizeof(*shape));
+    shape->is_4d = 1;
+    shape->v_count = side * side;
+    shape->e_count = side * side * 2;
+    shape->vertices = malloc(sizeof(Vertex) * shape->v_count);
+    shape->edges = malloc(sizeof(Edge) * shape->e_count);
+    if (!shape->vertices || !shape->edges) return 0;
+
+    const float two_pi = 6.28318530718f;
+    for (int i = 0; i < side; i++) {
+        for (int j = 0; j < side; j++) {
+            float u = two_pi * i / side, v = two_pi * j / side;
+            int idx = i * side + j;
+            shape->vertices[idx] = (Vertex){ cosf(u), sinf(u), cosf(v), sinf(v) };
+            shape->edges[2*idx] = (Edge){ idx, i * side + (j + 1) % side };
+            shape->edges[2*idx+1] = (Edge){ idx, ((i + 1) % side) * side + j };
+        }
+    }
+    return 1;
+}
+
+#ifdef POLYHEDRA_EGL
+static GLuint gl_vbo;
+
+static void draw_gl(void) {
+    // Upload and draw like the --cpu path, then wait so the time covers the whole frame
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * 2 * bench_shape->v_count, bench_xy);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDrawElements(GL_LINES, bench_shape->e_count * 2, GL_UNSIGNED_INT, 0);
+    glFinish();
+}
+
+static void report_gl(void) {
+    Headless headless;
+    if (!headless_init(&headless, WIDTH, HEIGHT)) return;
+
+    const char* vertex_source =
+        "#version 330 core\n"
+        "layout(location=0) in vec2 aPos;\n"
+        "void main() { gl_Position = vec4(aPos, 0.0, 1.0); }\n";
+    const char* fragment_source =
+        "#version 330 core\n"
+        "out vec4 FragColor;\n"
+        "void main() { FragColor = vec4(1.0); }\n";
+    GLuint vertex = glCreateShader(GL_VERTEX_SHADER), fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(vertex, 1, &vertex_source, NULL);
+    glCompileShader(vertex);
+    glShaderSource(fragment, 1, &fragment_source, NULL);
+    glCompileShader(fragment);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glUseProgram(program);
+
+    GLuint vao, ebo;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &gl_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, gl_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 2 * bench_shape->v_count, NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Edge) * bench_shape->e_count, bench_shape->edges, GL_STATIC_DRAW);
+    glViewport(0, 0, WIDTH, HEIGHT);
+    glLineWidth(2.0f);
+
+    double ms = measure(draw_gl);
+    fprintf(stdout, "\nGL (%s): %.2f ms per frame, %.1f fps\n", (const char*)glGetString(GL_RENDERER), ms, 1000.0 / ms);
+
+    glDeleteBuffers(1, &gl_vbo);
+    glDeleteBuffers(1, &ebo);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    headless_destroy(&headless);
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    // A number of edges for a generated torus, or a shape file
+    Polyhedron shape;
+    const char* source = argc > 1 ? argv[1] : "100000";
+    char* end;
+    long edges = strtol(source, &end, 10);
+    if (*end == '\0') {
+        if (edges <= 0 || !make_torus(&shape, (int)edges)) {
+            fprintf(stderr, "Can't generate a torus with %s edges\n", source);
+            return 1;
+        }
+    }
+    else if (!load_shape(source, &shape)) {
+        return 1;
+    }
+
+    float* xy = alloc_aligned(sizeof(float) * 2 * shape.v_count);
+    unsigned char* reference = malloc((size_t)WIDTH * HEIGHT * 4);
+    if (!xy || !reference) {
+        fprintf(stderr, "Out of memory for %d vertices\n", shape.v_count);
+        return 1;
+    }
+    Mat4 m = view_transform(shape.is_4d, 0.3f, 1.1f, 0.7f, -0.4f, 2.0f);
+    transform_shape(&m, &default_projection, &shape, xy);
+    bench_xy = xy;
+    bench_shape = &shape;
+
+    fprintf(stdout, "%d vertices, %d edges, %dx%d, %d pixel tiles\n", shape.v_count, shape.e_count, WIDTH, HEIGHT, RASTER_TILE);
+    fprintf(stdout, "%-8s %12s %10s %8s %10s\n", "threads", "ms/frame", "fps", "speedup", "image");
+
+    int cores = pool_cpu_count();
+    double base = 0.0;
+    // 1, 2, 4, ... and finally every core
+    for (int threads = 1; ; threads = threads * 2 < cores ? threads * 2 : cores) {
+        WorkerPool* pool = threads > 1 ? pool_create(threads - 1) : NULL;
+        Raster raster;
+        if (!raster_init(&raster, WIDTH, HEIGHT, pool)) {
+            fprintf(stderr, "Out of memory for the raster\n");
+            return 1;
+        }
+        bench_raster = &raster;
+        double ms = measure(draw_software);
+
+        const char* image = "reference";
+        if (threads == 1) {
+            base = ms;
+            memcpy(reference, raster.pixels, (size_t)WIDTH * HEIGHT * 4);
+        }
+        else {
+            image = memcmp(reference, raster.pixels, (size_t)WIDTH * HEIGHT * 4) == 0 ? "same" : "DIFFERS";
+        }
+        fprintf(stdout, "%-8d %12.2f %10.1f %7.2fx %10s\n", threads, ms, 1000.0 / ms, base / ms, image);
+
+        raster_destroy(&raster);
+        pool_destroy(pool);
+        if (threads == cores) break;
+    }
+
+#ifdef POLYHEDRA_EGL
+    report_gl();
+#endif
+
+    free(reference);
+    free_aligned(xy);
+    free_shape(&shape);
+    return 0;
+}
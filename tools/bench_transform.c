@@ -0,0 +1,254 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "transform.h"
+#include "timer.h"
+
+// CPU vertex transform throughput in vertices/second: the original per-vertex trig loop
+// against one composed matrix per frame, through each available kernel.
+// SIMD kernels are also checked against the scalar one, they should match bit for bit.
+
+static float angle_x = 0.3f, angle_y = 1.1f, angle_xw = 0.7f, angle_yw = -0.4f, angle_zw = 2.0f;
+
+// The projection loop main.c ran before math4d, trig calls for every vertex
+static void project_trig(const Vertex* in, int count, int is_4d, float* out) {
+    for (int i = 0; i < count; i++) {
+        float x = in[i].x, y = in[i].y, z = in[i].z, w = in[i].w;
+        if (is_4d) {
+            float nx = x * cosf(angle_xw) - w * sinf(angle_xw);
+            float nw = x * sinf(angle_xw) + w * cosf(angle_xw);
+            x = nx; w = nw;
+            float ny = y * cosf(angle_yw) - w * sinf(angle_yw);
+            nw = y * sinf(angle_yw) + w * cosf(angle_yw);
+            y = ny; w = nw;
+            float nz = z * cosf(angle_zw) - w * sinf(angle_zw);
+            nw = z * sinf(angle_zw) + w * cosf(angle_zw);
+            z = nz; w = nw;
+        }
+        float temp_y = y * cosf(angle_x) - z * sinf(angle_x);
+        float temp_z = y * sinf(angle_x) + z * cosf(angle_x);
+        y = temp_y; z = temp_z;
+        float temp_x = x * cosf(angle_y) + z * sinf(angle_y);
+        temp_z = -x * sinf(angle_y) + z * cosf(angle_y);
+        x = temp_x; z = temp_z;
+        if (is_4d) {
+            float w_factor = 1.0f / (2.0f - w * 0.3f);
+            x *= w_factor;
+            y *= w_factor;
+            z *= w_factor;
+        }
+        float factor = 50.0f / (4.0f - z * 0.5f);
+        out[2*i] = x * factor * 2.0f / 40.0f;
+        out[2*i+1] = y * factor / 20.0f;
+    }
+}
+
+static ProjectKernel matrix_kernel;
+static ProjectSoAKernel soa_kernel;
+static VertexSoA soa_input;
+
+static void project_matrix(const Vertex* in, int count, int is_4d, float* out) {
+    Mat4 m = view_transform(is_4d, angle_x, angle_y, angle_xw, angle_yw, angle_zw);
+    matrix_kernel(&m, &default_projection, is_4d, in, count, out);
+}
+
+// Same input converted with shape_to_soa
+static void project_matrix_soa(const Vertex* in, int count, int is_4d, float* out) {
+    (void)in;
+    Mat4 m = view_transform(is_4d, angle_x, angle_y, angle_xw, angle_yw, angle_zw);
+    soa_kernel(&m, &default_projection, &soa_input, count, out);
+}
+
+// Max difference to the trig loop, and how many values differ from the scalar AoS kernel (returned)
+static int report(const char* shape, const char* kernel, double rate, const float* out,
+                   const float* expected, const float* reference, int count) {
+    float max_err = 0.0f;
+    int mismatches = 0;
+    for (int i = 0; i < 2 * count; i++) {
+        float err = fabsf(out[i] - expected[i]);
+        if (err > max_err) max_err = err;
+        if (out[i] != reference[i]) mismatches++;
+    }
+    char exact[32];
+    if (mismatches) snprintf(exact, sizeof(exact), "%d differ", mismatches);
+    else snprintf(exact, sizeof(exact), "exact");
+    fprintf(stdout, "%-6s %-10s %16.0f %14.2e %12s\n", shape, kernel, rate, max_err, exact);
+    return mismatches;
+}
+
+// Vertices per second over enough repeats to run for about half a second
+static double measure(void (*run)(const Vertex*, int, int, float*), const Vertex* in, int count, int is_4d, float* out) {
+    int repeats = 0;
+    double start = timer_now(), elapsed;
+    do {
+        run(in, count, is_4d, out);
+        repeats++;
+        elapsed = timer_now() - start;
+    } while (elapsed < 0.5);
+    return (double)count * repeats / elapsed;
+}
+
+// Whole-shape projection through transform_shape_parallel
+static WorkerPool* scaling_pool;
+static Polyhedron* scaling_shape;
+
+static void project_parallel(const Vertex* in, int count, int is_4d, float* out) {
+    (void)in; (void)count;
+    Mat4 m = view_transform(is_4d, angle_x, angle_y, angle_xw, angle_yw, angle_zw);
+    transform_shape_parallel(scaling_pool, &m, &default_projection, scaling_shape, out);
+}
+
+// Thread scaling of the best kernel on a 4D shape, AoS and SoA
+static void report_scaling(const Vertex* in, int count, float* out) {
+    int cores = pool_cpu_count();
+    fprintf(stdout, "\nThread scaling, 4D, parallel above %d vertices\n", TRANSFORM_PARALLEL_MIN);
+    fprintf(stdout, "%-8s %16s %8s %16s %8s\n", "threads", "aos vertices/s", "speedup", "soa vertices/s", "speedup");
+
+    Polyhedron aos, soa;
+    memset(&aos, 0, sizeof(aos));
+    aos.is_4d = 1;
+    aos.v_count = count;
+    aos.vertices = (Vertex*)in;
+    soa = aos;
+    soa.vertices = malloc(sizeof(Vertex) * count);
+    memcpy(soa.vertices, in, sizeof(Vertex) * count);
+    if (!shape_to_soa(&soa)) return;
+
+    double base_aos = 0.0, base_soa = 0.0;
+    // 1, 2, 4, ... and finally every core
+    for (int threads = 1; ; threads = threads * 2 < cores ? threads * 2 : cores) {
+        scaling_pool = threads > 1 ? pool_create(threads - 1) : NULL;
+        scaling_shape = &aos;
+        double rate_aos = measure(project_parallel, in, count, 1, out);
+        scaling_shape = &soa;
+        double rate_soa = measure(project_parallel, in, count, 1, out);
+        pool_destroy(scaling_pool);
+
+        if (threads == 1) {
+            base_aos = rate_aos;
+            base_soa = rate_soa;
+        }
+        fprintf(stdout, "%-8d %16.0f %7.2fx %16.0f %7.2fx\n", threads, rate_aos, rate_aos / base_aos, rate_soa, rate_soa / base_soa);
+        if (threads == cores) break;
+    }
+    free_shape(&soa);
+}
+
+// Packed n-dimensional copies of the input for the N-D kernels
+static float* nd_coords;
+
+static void project_nd(const Vertex* in, int count, int dim, float* out) {
+    (void)in;
+    MatN m = view_transform_n(dim, angle_x, angle_y, angle_xw, angle_yw, angle_zw);
+    project_vertices_n(&m, &default_projection, nd_coords, count, out);
+}
+
+// Kernel per dimension; 3D and 4D have to match the Mat4 scalar kernel on the same points. Returns the
+// number of dimensions that don't
+static int report_nd(const Vertex* in, int count, float* out, float* reference) {
+    fprintf(stdout, "\nN-D kernels, packed coordinates\n");
+    fprintf(stdout, "%-6s %16s %12s\n", "dim", "vertices/s", "vs Mat4");
+    nd_coords = malloc(sizeof(float) * POLY_MAX_DIM * count);
+    if (!nd_coords) return 1;
+    int failures = 0;
+    for (int dim = 3; dim <= POLY_MAX_DIM; dim++) {
+        // The input's x, y, z(, w), further axes from a second pass over the same random numbers
+        for (int i = 0; i < count; i++) {
+            const float* v = &in[i].x;
+            const float* next = &in[(i + 1) % count].x;
+            for (int k = 0; k < dim; k++) nd_coords[i * dim + k] = k < 4 ? v[k] : next[k - 4];
+        }
+        double rate = measure(project_nd, in, count, dim, out);
+
+        const char* exact = "-";
+        if (dim <= 4) {
+            Mat4 m = view_transform(dim == 4, angle_x, angle_y, angle_xw, angle_yw, angle_zw);
+            Vertex* flat = malloc(sizeof(Vertex) * count);
+            if (!flat) {
+                failures++;
+                break;
+            }
+            for (int i = 0; i < count; i++) flat[i] = dim == 4 ? in[i] : (Vertex){ in[i].x, in[i].y, in[i].z, 0.0f };
+            project_vertices(&m, &default_projection, dim == 4, flat, count, reference);
+            free(flat);
+            exact = memcmp(out, reference, sizeof(float) * 2 * count) == 0 ? "exact" : "DIFFERS";
+            if (exact[0] == 'D') failures++;
+        }
+        fprintf(stdout, "%-6d %16.0f %12s\n", dim, rate, exact);
+    }
+    free(nd_coords);
+    return failures;
+}
+
+int main(int argc, char* argv[]) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    if (count <= 0) count = 1000000;
+
+    Vertex* in = malloc(sizeof(Vertex) * count);
+    float* expected = malloc(sizeof(float) * 2 * count);
+    float* out = malloc(sizeof(float) * 2 * count);
+    if (!in || !expected || !out) {
+        fprintf(stderr, "Out of memory for %d vertices\n", count);
+        return 1;
+    }
+    srand(1);
+    for (int i = 0; i < count; i++) {
+        in[i] = (Vertex){ rand() / (float)RAND_MAX * 2.0f - 1.0f, rand() / (float)RAND_MAX * 2.0f - 1.0f,
+                          rand() / (float)RAND_MAX * 2.0f - 1.0f, rand() / (float)RAND_MAX * 2.0f - 1.0f };
+    }
+
+    float* reference = malloc(sizeof(float) * 2 * count);
+    if (!reference) {
+        fprintf(stderr, "Out of memory for %d vertices\n", count);
+        return 1;
+    }
+
+    int failures = 0;
+    fprintf(stdout, "%d vertices, best kernel %s\n", count, transform_kernel_name(transform_best_kernel()));
+    fprintf(stdout, "%-6s %-10s %16s %14s %12s\n", "shape", "kernel", "vertices/s", "err vs trig", "vs scalar");
+    for (int is_4d = 0; is_4d <= 1; is_4d++) {
+        project_trig(in, count, is_4d, expected);
+        double trig = measure(project_trig, in, count, is_4d, out);
+        fprintf(stdout, "%-6s %-10s %16.0f %14s %12s\n", is_4d ? "4D" : "3D", "trig", trig, "-", "-");
+
+        for (int kind = KERNEL_SCALAR; kind < KERNEL_COUNT; kind++) {
+            matrix_kernel = transform_kernel((KernelKind)kind);
+            if (!matrix_kernel) continue;
+            double rate = measure(project_matrix, in, count, is_4d, out);
+            if (kind == KERNEL_SCALAR) memcpy(reference, out, sizeof(float) * 2 * count);
+            failures += report(is_4d ? "4D" : "3D", transform_kernel_name((KernelKind)kind), rate, out, expected, reference, count) > 0;
+        }
+
+        Polyhedron shape;
+        memset(&shape, 0, sizeof(shape));
+        shape.is_4d = is_4d;
+        shape.v_count = count;
+        shape.vertices = malloc(sizeof(Vertex) * count);
+        memcpy(shape.vertices, in, sizeof(Vertex) * count);
+        if (!shape_to_soa(&shape)) {
+            fprintf(stderr, "Out of memory for SoA copy\n");
+            return 1;
+        }
+        soa_input = shape.soa;
+        for (int kind = KERNEL_SCALAR; kind < KERNEL_COUNT; kind++) {
+            soa_kernel = transform_soa_kernel((KernelKind)kind);
+            if (!soa_kernel) continue;
+            double rate = measure(project_matrix_soa, in, count, is_4d, out);
+            char name[32];
+            snprintf(name, sizeof(name), "soa-%s", transform_kernel_name((KernelKind)kind));
+            failures += report(is_4d ? "4D" : "3D", name, rate, out, expected, reference, count) > 0;
+        }
+        free_shape(&shape);
+    }
+
+    report_scaling(in, count, out);
+    failures += report_nd(in, count, out, reference);
+
+    free(reference);
+    free(in);
+    free(expected);
+    free(out);
+    if (failures) fprintf(stderr, "%d kernels differ from the scalar one\n", failures);
+    return failures ? 1 : 0;
+}
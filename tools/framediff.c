@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "image.h"
+
+// Compares a rendered frame against a reference frame of the same size. Line rasterizers disagree
+// on anti-aliasing and on which of two neighbouring pixels a line lands on, so a pixel only counts as
+// different when nothing within a pixel of it in the other frame is close to its colour.
+
+#define CHANNEL_TOLERANCE 64
+
+static int close_to(const unsigned char* a, const unsigned char* b) {
+    for (int c = 0; c < 3; c++) {
+        if (abs(a[c] - b[c]) > CHANNEL_TOLERANCE) return 0;
+    }
+    return 1;
+}
+
+// Pixels of a with no close match in the 3x3 neighbourhood of the same spot in b
+static long unmatched(const unsigned char* a, const unsigned char* b, int width, int height) {
+    long count = 0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const unsigned char* pixel = a + ((size_t)y * width + x) * 3;
+            int found = 0;
+            for (int dy = -1; dy <= 1 && !found; dy++) {
+                for (int dx = -1; dx <= 1 && !found; dx++) {
+                    int nx = x + dx, ny = y + dy;
+                    if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                    found = close_to(pixel, b + ((size_t)ny * width + nx) * 3);
+                }
+            }
+            if (!found) count++;
+        }
+    }
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stdout, "Usage: framediff FRAME.ppm REFERENCE.ppm [PERCENT]\n"
+                        "Fail when more than PERCENT (default 0.1) of the pixels differ from the reference.\n\n");
+        return 1;
+    }
+    double limit = argc > 3 ? atof(argv[3]) : 0.1;
+
+    int width, height, ref_width, ref_height;
+    unsigned char* frame = image_read_ppm(argv[1], &width, &height);
+    unsigned char* reference = image_read_ppm(argv[2], &ref_width, &ref_height);
+    if (!frame || !reference) {
+        free(frame);
+        free(reference);
+        return 1;
+    }
+    if (width != ref_width || height != ref_height) {
+        fprintf(stderr, "%s is %dx%d but %s is %dx%d\n", argv[1], width, height, argv[2], ref_width, ref_height);
+        free(frame);
+        free(reference);
+        return 1;
+    }
+
+    // Both ways, so a missing line counts as much as a stray one
+    long differing = unmatched(frame, reference, width, height) + unmatched(reference, frame, width, height);
+    double percent = 100.0 * differing / (2.0 * width * height);
+    int ok = percent <= limit;
+    fprintf(stdout, "%s: %.3f%% of pixels differ from %s (limit %.3f%%): %s\n", argv[1], percent, argv[2], limit,
+            ok ? "ok" : "DIFFERENT");
+
+    free(frame);
+    free(reference);
+    return ok ? 0 : 1;
+}
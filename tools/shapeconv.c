@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shapes.h"
+#include "infer.h"
+#include "hull.h"
+#include "generators.h"
+
+// Converts text .shape files into the memory-mappable .shapeb format.
+// Each input is written next to itself as <input>b unless -o is given.
+// Vertex-only inputs get their edges inferred, so the binary file has them ready.
+// With --hull first, vertex-only 4D inputs get the edges of their convex hull instead
+// (--hull-rounded for polytopes whose cells are only flat to within float rounding).
+// "--gen SPEC" writes a generated shape (see generators.h) instead of reading one.
+
+static WorkerPool* pool;
+static int use_hull;
+static double hull_rounding;
+
+static int convert(const char* in_path, const char* out_path) {
+    Polyhedron shape;
+    if (!load_shape(in_path, &shape)) {
+        fprintf(stderr, "Shape \"%s\" failed to load\n", in_path);
+        return 0;
+    }
+    int derived = shape.e_count == 0 && shape.v_count > 1;
+    int hull = derived && use_hull && shape_dim(&shape) == 4;
+    HullStats stats;
+    if (derived && !(hull ? hull_edges(&shape, pool, hull_rounding, &stats) : infer_edges(&shape, pool, NULL))) {
+        free_shape(&shape);
+        return 0;
+    }
+    if (hull && stats.skipped) {
+        fprintf(stderr, "%s: the hull left out %d outside points it couldn't add, it may be missing vertices\n",
+                in_path, stats.skipped);
+    }
+
+    // Reject bad indices here so the viewer can trust binary files as-is
+    for (int i = 0; i < shape.e_count; i++) {
+        Edge e = shape.edges[i];
+        if (e.start < 0 || e.start >= shape.v_count || e.end < 0 || e.end >= shape.v_count) {
+            fprintf(stderr, "%s: edge %d (%d %d) out of range for %d vertices\n",
+                    in_path, i, e.start, e.end, shape.v_count);
+            free_shape(&shape);
+            return 0;
+        }
+    }
+
+    int ok = save_shape_binary(out_path, &shape);
+    if (ok) {
+        fprintf(stdout, "%s -> %s (%d vertices, %d %sedges)\n", in_path, out_path, shape.v_count, shape.e_count,
+                hull ? "hull " : derived ? "inferred " : "");
+    } else {
+        fprintf(stderr, "Failed to write \"%s\"\n", out_path);
+    }
+    free_shape(&shape);
+    return ok;
+}
+
+static int write_generated(const char* spec, const char* out_path) {
+    Polyhedron shape;
+    if (!generate_shape(spec, &shape)) return 0;
+    int ok = save_shape_binary(out_path, &shape);
+    if (ok) {
+        fprintf(stdout, "%s -> %s (%d vertices, %d edges)\n", spec, out_path, shape.v_count, shape.e_count);
+    } else {
+        fprintf(stderr, "Failed to write \"%s\"\n", out_path);
+    }
+    free_shape(&shape);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) {
+        fprintf(stdout, "Usage: shapeconv FILE.shape... \n"
+                        "       shapeconv FILE.shape -o OUTPUT.shapeb\n"
+                        "       shapeconv --gen SPEC -o OUTPUT.shapeb\n"
+                        "       shapeconv --hull FILE.shape...\n"
+                        "       shapeconv --hull-rounded FILE.shape...\n"
+                        "Convert text .shape files into the binary .shapeb format.\n\n");
+        return argc < 2;
+    }
+    if (strcmp(argv[1], "--hull") == 0 || strcmp(argv[1], "--hull-rounded") == 0) {
+        use_hull = 1;
+        hull_rounding = strcmp(argv[1], "--hull-rounded") == 0 ? HULL_ROUNDING : 0.0;
+        argv++;
+        argc--;
+    }
+
+    pool = pool_create(0);
+    int failed = 0;
+    if (argc == 5 && strcmp(argv[1], "--gen") == 0 && strcmp(argv[3], "-o") == 0) {
+        failed = !write_generated(argv[2], argv[4]);
+    } else if (argc == 4 && strcmp(argv[2], "-o") == 0) {
+        failed = !convert(argv[1], argv[3]);
+    } else {
+        for (int i = 1; i < argc; i++) {
+            char out_path[512];
+            snprintf(out_path, sizeof(out_path), "%sb", argv[i]);
+            if (!convert(argv[i], out_path)) failed++;
+        }
+    }
+    pool_destroy(pool);
+    return failed ? 1 : 0;
+}
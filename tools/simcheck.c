@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <string.h>
+#include "simclock.h"
+
+// Runs the viewer's frame loop on a fake clock: turn with auto-rotate, pause it (R) until the loop
+// sleeps, wake on idle timeouts for a while, then turn auto-rotate back on. Rotation has to be moving
+// again within a couple of frames, and a paused viewer has to stay asleep.
+
+#define FRAME_SECONDS (1.0 / 60.0)		// Vsync
+#define IDLE_WAIT_SECONDS 0.5			// As main.c sleeps between events
+
+typedef struct {
+    SimClock sim;
+    double now;
+    int presented;
+    float drawn[SIM_ANGLES];
+    int frames;							// Drawn so far
+} Viewer;
+
+// One pass of the main loop; a sleeping viewer wakes after wait seconds (an event or the timeout)
+static void loop_once(Viewer* v, int auto_rotate, double wait) {
+    static const float auto_velocity[SIM_ANGLES] = SIM_AUTO_ROTATE;
+    if (v->presented) {
+        v->now += FRAME_SECONDS;
+    }
+    else {
+        v->now += wait;
+        sim_resync(&v->sim, v->now);
+    }
+    for (int a = 0; a < SIM_ANGLES; a++) v->sim.velocity[a] = auto_rotate ? auto_velocity[a] : 0.0f;
+    sim_advance(&v->sim, v->now);
+
+    if (!sim_frame_due(&v->sim, v->drawn)) {
+        v->presented = 0;
+        return;
+    }
+    sim_present(&v->sim, v->drawn);
+    v->presented = 1;
+    v->frames++;
+}
+
+static int check(int ok, const char* what) {
+    fprintf(stdout, "%-52s %s\n", what, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(void) {
+    Viewer v;
+    memset(&v, 0, sizeof(v));
+    sim_init(&v.sim, 0.0);
+    v.presented = 1;
+    int ok = 1;
+
+    for (int i = 0; i < 60; i++) loop_once(&v, 1, IDLE_WAIT_SECONDS);
+    ok &= check(v.frames == 60, "auto-rotate draws every frame");
+
+    // Paused: one last frame settles on the final step, then the loop sleeps
+    int frames = v.frames;
+    for (int i = 0; i < 10; i++) loop_once(&v, 0, IDLE_WAIT_SECONDS);
+    ok &= check(!v.presented && v.frames - frames <= 2, "pausing goes to sleep");
+
+    frames = v.frames;
+    for (int i = 0; i < 100; i++) loop_once(&v, 0, IDLE_WAIT_SECONDS);
+    ok &= check(v.frames == frames, "idle wakes draw nothing");
+
+    // R pressed while asleep: the wake is the key event, a moment after the last timeout
+    float paused[SIM_ANGLES];
+    memcpy(paused, v.drawn, sizeof(paused));
+    frames = v.frames;
+    loop_once(&v, 1, 0.001);
+    ok &= check(v.frames == frames + 1, "resuming draws on the wake itself");
+    for (int i = 0; i < 2; i++) loop_once(&v, 1, IDLE_WAIT_SECONDS);
+    ok &= check(memcmp(paused, v.drawn, sizeof(paused)) != 0, "rotation moves within two frames of resuming");
+    for (int i = 0; i < 60; i++) loop_once(&v, 1, IDLE_WAIT_SECONDS);
+    ok &= check(v.frames == frames + 63, "and keeps drawing every frame");
+
+    return ok ? 0 : 1;
+}
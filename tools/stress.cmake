@@ -0,0 +1,43 @@
+# Stress test, run by ctest as "stress" or by hand with
+#   cmake -DPOLYHEDRA=... -DSTRESSGEN=... -DFRAMEDIFF=... -DWORK_DIR=... -P tools/stress.cmake
+# A torus with millions of vertices is rendered offscreen through GL (--headless) and has to match the
+# software rasterizer's frame of the same rotation, then --bench has to keep its p99 frame time within
+# MAX_JITTER times the median.
+
+foreach(var POLYHEDRA STRESSGEN FRAMEDIFF WORK_DIR)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "stress.cmake needs -D${var}=...")
+    endif()
+endforeach()
+if(NOT DEFINED VERTICES)
+    set(VERTICES 2000000)
+endif()
+if(NOT DEFINED MAX_JITTER)
+    set(MAX_JITTER 4)
+endif()
+set(VELOCITY 0.2,0.3,0.5,0.7,0.9)
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Failed (${result}): ${ARGN}")
+    endif()
+endfunction()
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR}/shapes)
+run(${STRESSGEN} ${VERTICES} ${WORK_DIR}/shapes/torus.shapeb)
+
+# Two frames each, the second one a second into the rotation
+run(${POLYHEDRA} --dir ${WORK_DIR}/shapes --headless --duration 2 --fps 1 --velocity ${VELOCITY} --out ${WORK_DIR}/gl)
+run(${POLYHEDRA} --dir ${WORK_DIR}/shapes --renderer=software --duration 2 --fps 1 --velocity ${VELOCITY}
+    --out ${WORK_DIR}/software)
+foreach(frame frame_00000.ppm frame_00001.ppm)
+    if(NOT EXISTS ${WORK_DIR}/gl/${frame} OR NOT EXISTS ${WORK_DIR}/software/${frame})
+        message(FATAL_ERROR "${frame} wasn't written")
+    endif()
+    run(${FRAMEDIFF} ${WORK_DIR}/gl/${frame} ${WORK_DIR}/software/${frame})
+endforeach()
+
+run(${POLYHEDRA} --dir ${WORK_DIR}/shapes --headless --bench torus.shapeb --frames 60 --velocity ${VELOCITY}
+    --max-jitter ${MAX_JITTER} --json ${WORK_DIR}/bench.json)
@@ -0,0 +1,52 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shapes.h"
+
+// Writes a large Clifford torus (4D) as .shapeb for stress testing the viewer.
+// The wireframe is a regular grid, so a broken projection or index upload is obvious on screen.
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stdout, "Usage: stressgen VERTICES OUTPUT.shapeb\n"
+                        "Write a 4D torus grid with about VERTICES vertices and twice as many edges.\n\n");
+        return 1;
+    }
+
+    long requested = atol(argv[1]);
+    int side = (int)sqrt((double)(requested > 4 ? requested : 4));
+    if (side < 2) side = 2;
+
+    Polyhedron shape;
+    memset(&shape, 0, sizeof(shape));
+    snprintf(shape.name, sizeof(shape.name), "Torus%dx%d", side, side);
+    shape.is_4d = 1;
+    shape.v_count = side * side;
+    shape.e_count = side * side * 2;
+    shape.vertices = malloc(sizeof(Vertex) * shape.v_count);
+    shape.edges = malloc(sizeof(Edge) * shape.e_count);
+    if (!shape.vertices || !shape.edges) {
+        fprintf(stderr, "Out of memory for %d vertices\n", shape.v_count);
+        return 1;
+    }
+
+    const float two_pi = 6.28318530718f;
+    for (int i = 0; i < side; i++) {
+        for (int j = 0; j < side; j++) {
+            float u = two_pi * i / side, v = two_pi * j / side;
+            int idx = i * side + j;
+            shape.vertices[idx] = (Vertex){ cosf(u), sinf(u), cosf(v), sinf(v) };
+            // Link to the next vertex around each circle
+            shape.edges[2*idx] = (Edge){ idx, i * side + (j + 1) % side };
+            shape.edges[2*idx+1] = (Edge){ idx, ((i + 1) % side) * side + j };
+        }
+    }
+
+    int ok = save_shape_binary(argv[2], &shape);
+    if (ok) fprintf(stdout, "%s: %d vertices, %d edges\n", argv[2], shape.v_count, shape.e_count);
+    else fprintf(stderr, "Failed to write \"%s\"\n", argv[2]);
+    free(shape.vertices);
+    free(shape.edges);
+    return ok ? 0 : 1;
+}